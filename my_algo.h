@@ -244,15 +244,15 @@ template <class T>
 inline T* __copy_backward_t(const T* first, const T* last, 
 						    T* result, __true_type)
 {
-	memmove(result - (first - last), first, sizeof(T)*(last-first));
+	memmove(result - (last - first), first, sizeof(T)*(last-first));
 	return result - (last - first);
 }
 template <class T>
 inline T* __copy_backward_t(const T* first, const T* last, 
 						    T* result, __false_type)
 {
-	for(; first <= last; ++first, --last, --result)
-		*result = *last;
+	while(first != last)
+		*--result = *--last;
 	return result;
 }
 
@@ -303,7 +303,7 @@ inline typename iterator_traits<InputIterator>::difference_type
 distance(InputIterator first, InputIterator last)
 {
     typedef typename iterator_traits<InputIterator>::iterator_category category;
-    __distance(first, last, category());
+    return __distance(first, last, category());
 }
 
 //======================================= EQUAL =========================================================
@@ -327,6 +327,22 @@ bool equal(InputIterator1 first1, InputIterator1 last1, InputIterator2 first2, B
     return true;
 }
 
+//================================ LEXICOGRAPHICAL_COMPARE ===============================================
+// true if [first1, last1) orders before [first2, last2), element by element
+template <class InputIterator1, class InputIterator2>
+bool lexicographical_compare(InputIterator1 first1, InputIterator1 last1,
+                             InputIterator2 first2, InputIterator2 last2)
+{
+    for( ; first1 != last1 && first2 != last2; ++first1, ++first2)
+    {
+        if(*first1 < *first2)
+            return true;
+        if(*first2 < *first1)
+            return false;
+    }
+    return first1 == last1 && first2 != last2;
+}
+
 /*========================= FILL =====================================*/
 template <class ForwardIterator, class T>
 void fill(ForwardIterator first, ForwardIterator last, const T& x)
@@ -696,6 +712,7 @@ bool includes(InputIterator1 first1, InputIterator1 last1,
 //===================================== MERGE ======================================================
 // Merge two sorted ranges S1 and S2
 // Default sorting order is less_than()
+// Stable: of two equal elements, the one of S1 comes first
 template <class InputIterator1, class InputIterator2, class OutputIterator>
 OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
                      InputIterator2 first2, InputIterator2 last2,
@@ -703,19 +720,19 @@ OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
 {
     while(first1 != last1 && first2 != last2)
     {
-        if(*first1 < *first2)
+        if(*first2 < *first1)
         {
-            *result = *first1;
-            ++first1;
+            *result = *first2;
+            ++first2;
         }
         else
         {
-            *result = *first2;
-            ++first2;
+            *result = *first1;
+            ++first1;
         }
         ++result;
     }
-    return copy(first2, last2, copy(first1, last1, result));
+    return fyj::copy(first2, last2, fyj::copy(first1, last1, result));
 }
 template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
 OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
@@ -725,19 +742,19 @@ OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
 {
     while(first1 != last1 && first2 != last2)
     {
-        if(comp(*first1, *first2))
+        if(comp(*first2, *first1))
         {
-            *result = *first1;
-            ++first1;
+            *result = *first2;
+            ++first2;
         }
         else
         {
-            *result = *first2;
-            ++first2;
+            *result = *first1;
+            ++first1;
         }
         ++result;
     }
-    return copy(first2, last2, copy(first1, last1, result));
+    return fyj::copy(first2, last2, fyj::copy(first1, last1, result));
 }
 
 
@@ -1422,6 +1439,116 @@ bool prev_permutation(BidirectionalIterator first, BidirectionalIterator last,
 //           * List                         --> member function sort() defined in List class
 //           * Vector, Deque                --> could use this sort algorithm
 
+// Insertion sort: stable, and the fastest on short ranges
+template <class RandomAccessIterator, class T, class Compare>
+void __unguarded_linear_insert(RandomAccessIterator last, T value,
+                               Compare comp)
+{
+    RandomAccessIterator next = last;
+    --next;
+    while(comp(value, *next))
+    {
+        *last = *next;
+        last = next;
+        --next;
+    }
+    *last = value;
+}
+
+// Insert *last into the sorted [first, last)
+template <class RandomAccessIterator, class T, class Compare>
+inline void __linear_insert(RandomAccessIterator first,
+                            RandomAccessIterator last, T*, Compare comp)
+{
+    T value = *last;
+    if(comp(value, *first))
+    {
+        fyj::copy_backward(first, last, last + 1);
+        *first = value;
+    }
+    else
+        fyj::__unguarded_linear_insert(last, value, comp);
+}
+
+template <class RandomAccessIterator, class Compare>
+void __insertion_sort(RandomAccessIterator first, RandomAccessIterator last,
+                      Compare comp)
+{
+    if(first == last)
+        return;
+    for(RandomAccessIterator i = first + 1; i != last; ++i)
+        fyj::__linear_insert(first, i, value_type(first), comp);
+}
+
+// Merge sort: runs of __stl_chunk_size are insertion sorted, then
+// merged pairwise back and forth between the range and the buffer
+const int __stl_chunk_size = 7;
+
+template <class RandomAccessIterator, class Distance, class Compare>
+void __chunk_insertion_sort(RandomAccessIterator first,
+                            RandomAccessIterator last,
+                            Distance chunk_size, Compare comp)
+{
+    while(last - first >= chunk_size)
+    {
+        fyj::__insertion_sort(first, first + chunk_size, comp);
+        first += chunk_size;
+    }
+    fyj::__insertion_sort(first, last, comp);
+}
+
+// Merge the runs of step_size of [first, last) two by two into result
+template <class RandomAccessIterator1, class RandomAccessIterator2,
+          class Distance, class Compare>
+void __merge_sort_loop(RandomAccessIterator1 first,
+                       RandomAccessIterator1 last,
+                       RandomAccessIterator2 result, Distance step_size,
+                       Compare comp)
+{
+    Distance two_step = 2 * step_size;
+    while(last - first >= two_step)
+    {
+        result = fyj::merge(first, first + step_size,
+                       first + step_size, first + two_step, result, comp);
+        first += two_step;
+    }
+    if(last - first < step_size)
+        step_size = last - first;
+    fyj::merge(first, first + step_size, first + step_size, last, result, comp);
+}
+
+template <class RandomAccessIterator, class Pointer, class Distance,
+          class Compare>
+void __merge_sort_with_buffer(RandomAccessIterator first,
+                              RandomAccessIterator last,
+                              Pointer buffer, Distance*, Compare comp)
+{
+    Distance len = last - first;
+    Pointer buffer_last = buffer + len;
+    Distance step_size = __stl_chunk_size;
+    fyj::__chunk_insertion_sort(first, last, step_size, comp);
+    // two passes per round, so the result always ends in [first, last)
+    while(step_size < len)
+    {
+        fyj::__merge_sort_loop(first, last, buffer, step_size, comp);
+        step_size *= 2;
+        fyj::__merge_sort_loop(buffer, buffer_last, first, step_size, comp);
+        step_size *= 2;
+    }
+}
+
+// Stable sort of [first, last): equal elements keep their order
+// buffer: scratch space of at least (last - first) constructed
+// elements (it is assigned to, not constructed), e.g. a vector
+// O(n log n) comparisons
+template <class RandomAccessIterator, class Pointer, class Compare>
+inline void stable_sort(RandomAccessIterator first, RandomAccessIterator last,
+                        Pointer buffer, Compare comp)
+{
+    fyj::__merge_sort_with_buffer(first, last, buffer, difference_type(first),
+                             comp);
+}
+
 
 
 
@@ -0,0 +1,191 @@
+/* Blocked Bloom filter
+ *
+ * A set of keys that may answer "maybe" for a key never inserted
+ * (false positive, ~1% at 10 bits per key) but never answers "no"
+ * for a key that was inserted. Keys cannot be removed.
+ *
+ * The bits are split into blocks of one cache line (8 words of 64
+ * bits). A key picks one block with the high half of its hash and
+ * sets one bit in each of the 8 words with the low half (split block
+ * Bloom filter), so an insert or a lookup touches a single cache line.
+ * With AVX2 the 8 bit positions are computed and tested at once.
+ */
+
+#ifndef _MY_BLOOM_FILTER_
+#define _MY_BLOOM_FILTER_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include <stdint.h>
+#include "my_algo.h"
+#include "my_functors.h"
+#include "my_int_hash_table.h" // for __int_hash_mix
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#endif
+
+namespace fyj
+{
+
+// Odd multipliers giving the bit of each word from the low hash half
+static const uint32_t __bloom_salt[8] =
+{
+	0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+	0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+template <class Key,
+		  class HashFun = hash<Key>,
+		  class Alloc = alloc>
+class blocked_bloom_filter
+{
+public:
+	typedef Key key_type;
+	typedef HashFun hasher;
+	typedef size_t size_type;
+
+private:
+	typedef simple_alloc<char, Alloc> data_allocator;
+	enum {cache_line = 64};
+	enum {block_words = 8};
+
+	struct block {uint64_t words[block_words];};
+
+	hasher hash;
+	char* mem;			// as allocated
+	block* blocks;		// mem aligned to a cache line
+	size_type num_blocks;
+	size_type max_keys;
+	size_type key_bits;
+
+	size_type mem_size() const {return num_blocks * sizeof(block) + cache_line;}
+	size_type blocks_for(size_type n) const
+	{return n * key_bits / (sizeof(block) * 8) + 1;}
+
+	void allocate(size_type n_blocks)
+	{
+		num_blocks = n_blocks;
+		mem = data_allocator::allocate(mem_size());
+		blocks = (block*)(mem + (cache_line -
+				 (size_t)mem % cache_line) % cache_line);
+		clear();
+	}
+
+	// Block from the high half: (hi * num_blocks) >> 32
+	const block& block_of(uint64_t h) const
+	{return blocks[size_type(((h >> 32) * num_blocks) >> 32)];}
+
+	// 64 mixed bits, also where size_t has 32
+	static uint64_t mixed(size_t h)
+	{
+		uint64_t m = __int_hash_mix(h);
+		if(sizeof(size_t) < sizeof(uint64_t))
+			m = (m << 32) | __int_hash_mix(h ^ 0x9e3779b9UL);
+		return m;
+	}
+
+public:
+	// Sized for max_n keys at bits_per_key bits each
+	explicit blocked_bloom_filter(size_type max_n, size_type bits_per_key = 10,
+								  const hasher& hf = hasher())
+		: hash(hf), max_keys(max_n), key_bits(bits_per_key)
+	{
+		allocate(blocks_for(max_n));
+	}
+
+	blocked_bloom_filter(const blocked_bloom_filter& x)
+		: hash(x.hash), max_keys(x.max_keys), key_bits(x.key_bits)
+	{
+		allocate(x.num_blocks);
+		copy(x.blocks, x.blocks + num_blocks, blocks);
+	}
+
+	blocked_bloom_filter& operator=(const blocked_bloom_filter& x)
+	{
+		if(this != &x)
+		{
+			blocked_bloom_filter temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~blocked_bloom_filter() {data_allocator::deallocate(mem, mem_size());}
+
+	void swap(blocked_bloom_filter& x)
+	{
+		fyj::swap(hash, x.hash);
+		fyj::swap(mem, x.mem);
+		fyj::swap(blocks, x.blocks);
+		fyj::swap(num_blocks, x.num_blocks);
+		fyj::swap(max_keys, x.max_keys);
+		fyj::swap(key_bits, x.key_bits);
+	}
+
+	// Number of keys the filter was sized for
+	size_type capacity() const {return max_keys;}
+	size_type size_in_bytes() const {return num_blocks * sizeof(block);}
+
+	void clear()
+	{
+		for(size_type i = 0; i < num_blocks; ++i)
+			for(int w = 0; w < block_words; ++w)
+				blocks[i].words[w] = 0;
+	}
+
+	// Empty filter sized for max_n keys
+	void reset(size_type max_n)
+	{
+		data_allocator::deallocate(mem, mem_size());
+		max_keys = max_n;
+		allocate(blocks_for(max_n));
+	}
+
+	// Never fails: true, like cuckoo_filter::insert when there is room
+	bool insert(const key_type& key)
+	{
+		uint64_t h = mixed(hash(key));
+		block& b = const_cast<block&>(block_of(h));
+		uint32_t lo = uint32_t(h);
+		for(int w = 0; w < block_words; ++w)
+			b.words[w] |= uint64_t(1) << ((lo * __bloom_salt[w]) >> 26);
+		return true;
+	}
+
+	// false: key was never inserted; true: key was probably inserted
+	bool possibly_contains(const key_type& key) const
+	{
+		uint64_t h = mixed(hash(key));
+		const block& b = block_of(h);
+		uint32_t lo = uint32_t(h);
+#if defined(__AVX2__)
+		// 8 bit positions at once, then 8 word tests in two halves
+		__m256i salt = _mm256_loadu_si256((const __m256i*)__bloom_salt);
+		__m256i bit = _mm256_srli_epi32(
+			_mm256_mullo_epi32(_mm256_set1_epi32(int(lo)), salt), 26);
+		__m256i one = _mm256_set1_epi64x(1);
+		__m256i m0 = _mm256_sllv_epi64(one,
+			_mm256_cvtepu32_epi64(_mm256_castsi256_si128(bit)));
+		__m256i m1 = _mm256_sllv_epi64(one,
+			_mm256_cvtepu32_epi64(_mm256_extracti128_si256(bit, 1)));
+		__m256i w0 = _mm256_load_si256((const __m256i*)b.words);
+		__m256i w1 = _mm256_load_si256((const __m256i*)(b.words + 4));
+		// testc: all bits of the mask are set in the words
+		return _mm256_testc_si256(w0, m0) && _mm256_testc_si256(w1, m1);
+#else
+		// no early exit: the 8 tests are cheaper than a mispredict
+		uint64_t all = 1;
+		for(int w = 0; w < block_words; ++w)
+			all &= b.words[w] >> ((lo * __bloom_salt[w]) >> 26);
+		return all & 1;
+#endif
+	}
+
+	// Keys cannot be taken out of a Bloom filter: no-op, so that
+	// the filter can be used where a cuckoo filter could be
+	void erase(const key_type&) {}
+};
+
+} // end of namespace
+
+#endif
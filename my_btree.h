@@ -0,0 +1,915 @@
+/* B-tree, the cache friendly alternative to rb_tree for ordered
+ * containers (btree_map / btree_set / btree_multimap / btree_multiset)
+ *
+ * A node holds up to N sorted values, N chosen so that the values of
+ * a node fill about 256 bytes (4 cache lines), and if internal N + 1
+ * children. Compared with rb_tree:
+ *     # a lookup binary searches inside a node then goes down one
+ *       child, so it reads ~log(n) / log(N) nodes instead of ~log2(n)
+ *       rb_tree nodes scattered in memory, each a cache miss
+ *     # there is no per-value node header (three pointers and a
+ *       color): for small keys memory per element is close to
+ *       sizeof(Value)
+ *     # leaves, most of the nodes, have no child array
+ * Every node but the root holds at least one value. A split in the
+ * middle leaves two halves of N / 2 values, but one at either end
+ * (sequential inserts, likely) keeps the full part in one node and
+ * leaves a single value in the other, so that full nodes are left
+ * behind. Only erase brings a node back up to N / 2 values, by
+ * taking from or merging with a sibling.
+ *
+ * Values are moved by copy construction, never assigned, so the key
+ * of pair<const Key, T> stays const. Inserts and erases move values
+ * inside and between nodes: both invalidate iterators.
+ * There are no per-value nodes, so no node handles (extract / merge).
+ */
+
+#ifndef _MY_BTREE_
+#define _MY_BTREE_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_construct.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+
+namespace fyj
+{
+
+// Bytes of values a node aims at
+static const size_t __btree_node_bytes = 256;
+
+// Values per node: at least 3, so that a split leaves both halves
+// with a value
+template <class Value>
+struct __btree_node_values
+{
+	enum {fit = __btree_node_bytes / sizeof(Value)};
+	enum {value = fit < 3 ? 3 : fit};
+};
+
+template <class Value, int N>
+struct __btree_node
+{
+	__btree_node* parent;
+	unsigned short position;	// index in the children of parent
+	unsigned short count;		// number of values
+	bool leaf;
+	// Raw storage: a value is only built when it is inserted
+	union
+	{
+		char raw[N * sizeof(Value)];
+		void* align_p;
+		long long align_ll;
+		double align_d;
+		long double align_ld;
+	} storage;
+
+	Value* values() {return (Value*)storage.raw;}
+	Value& value(int i) {return values()[i];}
+};
+
+template <class Value, int N>
+struct __btree_internal_node : public __btree_node<Value, N>
+{
+	__btree_node<Value, N>* children[N + 1];
+};
+
+template <class Value, int N>
+struct __btree_iterator_base
+{
+	typedef __btree_node<Value, N> node;
+	typedef __btree_internal_node<Value, N> internal_node;
+	typedef bidirectional_iterator_tag iterator_category;
+	typedef ptrdiff_t difference_type;
+
+	node* n;
+	int pos;
+
+	static node* child(node* x, int i)
+	{return ((internal_node*)x)->children[i];}
+
+	void increment()
+	{
+		if(!n->leaf)
+		{
+			// leftmost value of the subtree right of pos
+			n = child(n, pos + 1);
+			while(!n->leaf)
+				n = child(n, 0);
+			pos = 0;
+			return;
+		}
+		if(++pos < n->count)
+			return;
+		// past the end of a leaf: up to the first ancestor value
+		// on the right; none means end(), which stays here
+		node* save = n;
+		int save_pos = pos;
+		while(pos == n->count && n->parent)
+		{
+			pos = n->position;
+			n = n->parent;
+		}
+		if(pos == n->count)
+		{
+			n = save;
+			pos = save_pos;
+		}
+	}
+
+	void decrement()
+	{
+		if(!n->leaf)
+		{
+			// rightmost value of the subtree left of pos
+			n = child(n, pos);
+			while(!n->leaf)
+				n = child(n, n->count);
+			pos = n->count - 1;
+			return;
+		}
+		while(pos == 0 && n->parent)
+		{
+			pos = n->position;
+			n = n->parent;
+		}
+		--pos;
+	}
+};
+
+template <class Value, class Ref, class Ptr, int N>
+struct __btree_iterator : public __btree_iterator_base<Value, N>
+{
+	typedef __btree_iterator_base<Value, N> base;
+	typedef typename base::node node;
+	typedef Value value_type;
+	typedef Ref reference;
+	typedef Ptr pointer;
+	typedef __btree_iterator<Value, Value&, Value*, N> iterator;
+	typedef __btree_iterator<Value, const Value&, const Value*, N>
+		const_iterator;
+	typedef __btree_iterator<Value, Ref, Ptr, N> self;
+
+	__btree_iterator() {}
+	__btree_iterator(node* x, int p) {this->n = x; this->pos = p;}
+	__btree_iterator(const iterator& it) {this->n = it.n; this->pos = it.pos;}
+
+	reference operator*() const {return this->n->value(this->pos);}
+	pointer operator->() const {return &(operator*());}
+
+	self& operator++()
+	{
+		this->increment();
+		return *this;
+	}
+
+	self operator++(int)
+	{
+		self temp = *this;
+		this->increment();
+		return temp;
+	}
+
+	self& operator--()
+	{
+		this->decrement();
+		return *this;
+	}
+
+	self operator--(int)
+	{
+		self temp = *this;
+		this->decrement();
+		return temp;
+	}
+};
+
+template <class Value, int N>
+inline bool operator==(const __btree_iterator_base<Value, N>& x,
+					   const __btree_iterator_base<Value, N>& y)
+{
+	return x.n == y.n && x.pos == y.pos;
+}
+
+template <class Value, int N>
+inline bool operator!=(const __btree_iterator_base<Value, N>& x,
+					   const __btree_iterator_base<Value, N>& y)
+{
+	return x.n != y.n || x.pos != y.pos;
+}
+
+// Same template parameters as rb_tree
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc = alloc>
+class btree
+{
+public:
+	typedef Key                   key_type;
+	typedef Value                 value_type;
+	typedef value_type* 		  pointer;
+	typedef const value_type* 	  const_pointer;
+	typedef value_type& 	      reference;
+	typedef const value_type&     const_reference;
+	typedef size_t                size_type;
+	typedef ptrdiff_t             difference_type;
+
+	enum {node_values = __btree_node_values<Value>::value};
+
+	typedef __btree_iterator<Value, Value&, Value*, node_values> iterator;
+	typedef __btree_iterator<Value, const Value&, const Value*, node_values>
+		const_iterator;
+	typedef fyj::reverse_iterator<iterator> reverse_iterator;
+	typedef fyj::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+	typedef __btree_node<Value, node_values> node;
+	typedef __btree_internal_node<Value, node_values> internal_node;
+	typedef simple_alloc<node, Alloc> leaf_allocator;
+	typedef simple_alloc<internal_node, Alloc> internal_allocator;
+
+	enum {min_values = node_values / 2};
+
+	node* root;
+	node* leftmost;		// first leaf, for begin()
+	node* rightmost;	// last leaf, for end()
+	size_type value_count;
+	Compare key_compare;
+
+	//================= NODES ==================================
+	static const Key& key(node* x, int i) {return KeyOfValue()(x->value(i));}
+	static node*& child(node* x, int i)
+	{return ((internal_node*)x)->children[i];}
+
+	static void set_child(node* x, int i, node* c)
+	{
+		child(x, i) = c;
+		c->parent = x;
+		c->position = i;
+	}
+
+	static node* new_leaf()
+	{
+		node* x = leaf_allocator::allocate();
+		x->parent = 0;
+		x->position = 0;
+		x->count = 0;
+		x->leaf = true;
+		return x;
+	}
+
+	// Children are cleared so that a half built node can be freed
+	static node* new_internal()
+	{
+		internal_node* x = internal_allocator::allocate();
+		x->parent = 0;
+		x->position = 0;
+		x->count = 0;
+		x->leaf = false;
+		for(int i = 0; i <= node_values; ++i)
+			x->children[i] = 0;
+		return x;
+	}
+
+	static void free_node(node* x)
+	{
+		destroy(x->values(), x->values() + x->count);
+		if(x->leaf)
+			leaf_allocator::deallocate(x);
+		else
+			internal_allocator::deallocate((internal_node*)x);
+	}
+
+	//================= VALUE MOVES ============================
+	// Copy *src into the raw slot dst, then destroy *src
+	static void move_value(Value* dst, Value* src)
+	{
+		construct(dst, *src);
+		destroy(src);
+	}
+
+	// Values [i, count) one slot right; slot i is left raw
+	static void shift_right(node* x, int i)
+	{
+		for(int j = x->count; j > i; --j)
+			move_value(x->values() + j, x->values() + j - 1);
+	}
+
+	// Values (i, count) one slot left into the raw slot i
+	static void shift_left(node* x, int i)
+	{
+		for(int j = i; j + 1 < x->count; ++j)
+			move_value(x->values() + j, x->values() + j + 1);
+	}
+
+	//================= SEARCH IN A NODE =======================
+	// First i with !(key(i) < k)
+	// The range is halved with a select, not a branch: no mispredicted
+	// jumps inside a node
+	template <class K>
+	int lower_index(node* x, const K& k) const
+	{
+		int lo = 0, n = x->count;
+		if(!n)
+			return 0;
+		while(n > 1)
+		{
+			int half = n >> 1;
+			lo = key_compare(key(x, lo + half - 1), k) ? lo + half : lo;
+			n -= half;
+		}
+		return lo + (key_compare(key(x, lo), k) ? 1 : 0);
+	}
+
+	// First i with k < key(i)
+	template <class K>
+	int upper_index(node* x, const K& k) const
+	{
+		int lo = 0, n = x->count;
+		if(!n)
+			return 0;
+		while(n > 1)
+		{
+			int half = n >> 1;
+			lo = key_compare(k, key(x, lo + half - 1)) ? lo : lo + half;
+			n -= half;
+		}
+		return lo + (key_compare(k, key(x, lo)) ? 0 : 1);
+	}
+
+	//================= INSERT =================================
+	// Split the full node x before a value goes to slot insert_pos:
+	// the upper part goes to a new right sibling, the median up to
+	// the parent (split first if full too; a full root grows a new one)
+	void split(node* x, int insert_pos)
+	{
+		if(!x->parent)
+		{
+			node* r = new_internal();
+			set_child(r, 0, x);
+			root = r;
+		}
+		else if(x->parent->count == node_values)
+			split(x->parent, x->position);
+
+		node* p = x->parent;
+		node* sib = x->leaf ? new_leaf() : new_internal();
+		// At either end, the inserts are likely sequential: keep
+		// the other half full
+		const int right = insert_pos == 0 ? node_values - 1
+						: insert_pos == node_values ? 0
+						: node_values / 2;
+		const int left = node_values - right - 1;	// median slot
+
+		for(int j = 0; j < right; ++j)
+			move_value(sib->values() + j, x->values() + left + 1 + j);
+		sib->count = right;
+		if(!x->leaf)
+			for(int j = 0; j <= right; ++j)
+				set_child(sib, j, child(x, left + 1 + j));
+
+		const int pos = x->position;
+		shift_right(p, pos);
+		move_value(p->values() + pos, x->values() + left);
+		x->count = left;
+		for(int j = p->count + 1; j > pos + 1; --j)
+			set_child(p, j, child(p, j - 1));
+		++p->count;
+		set_child(p, pos + 1, sib);
+
+		if(x == rightmost)
+			rightmost = sib;
+	}
+
+	// Insert v at slot i of leaf x; x = 0 for an empty tree
+	iterator insert_at(node* x, int i, const value_type& v)
+	{
+		if(!x)
+			root = leftmost = rightmost = x = new_leaf();
+		if(x->count == node_values)
+		{
+			split(x, i);
+			if(i > x->count)
+			{
+				i -= x->count + 1;
+				x = child(x->parent, x->position + 1);
+			}
+		}
+		shift_right(x, i);
+		try {
+			construct(x->values() + i, v);
+		}
+		catch(...){
+			++x->count;
+			shift_left(x, i);
+			--x->count;
+			throw;
+		}
+		++x->count;
+		++value_count;
+		return iterator(x, i);
+	}
+
+	// v goes after all the values: no descent needed
+	bool after_last(const Key& k) const
+	{
+		return value_count &&
+			   key_compare(key(rightmost, rightmost->count - 1), k);
+	}
+
+	//================= ERASE ==================================
+	// Move the separator and the whole right into left, drop right
+	void merge(node* left, node* right)
+	{
+		node* p = left->parent;
+		const int pos = left->position;
+		const int lc = left->count;
+
+		move_value(left->values() + lc, p->values() + pos);
+		for(int j = 0; j < right->count; ++j)
+			move_value(left->values() + lc + 1 + j, right->values() + j);
+		if(!left->leaf)
+			for(int j = 0; j <= right->count; ++j)
+				set_child(left, lc + 1 + j, child(right, j));
+		left->count = lc + 1 + right->count;
+		right->count = 0;
+
+		shift_left(p, pos);
+		for(int j = pos + 1; j < p->count; ++j)
+			set_child(p, j, child(p, j + 1));
+		--p->count;
+
+		if(right == rightmost)
+			rightmost = left;
+		free_node(right);
+	}
+
+	// n values from the front of right to the end of x, through
+	// the separator
+	void rotate_left(node* x, node* right, int n)
+	{
+		node* p = x->parent;
+		const int pos = x->position;
+		const int xc = x->count;
+
+		move_value(x->values() + xc, p->values() + pos);
+		for(int j = 0; j < n - 1; ++j)
+			move_value(x->values() + xc + 1 + j, right->values() + j);
+		move_value(p->values() + pos, right->values() + n - 1);
+		for(int j = 0; j + n < right->count; ++j)
+			move_value(right->values() + j, right->values() + j + n);
+		if(!x->leaf)
+		{
+			for(int j = 0; j < n; ++j)
+				set_child(x, xc + 1 + j, child(right, j));
+			for(int j = 0; j + n <= right->count; ++j)
+				set_child(right, j, child(right, j + n));
+		}
+		x->count += n;
+		right->count -= n;
+	}
+
+	// n values from the end of left to the front of x
+	void rotate_right(node* left, node* x, int n)
+	{
+		node* p = x->parent;
+		const int pos = left->position;
+		const int xc = x->count;
+		const int lc = left->count;
+
+		for(int j = xc - 1; j >= 0; --j)
+			move_value(x->values() + j + n, x->values() + j);
+		move_value(x->values() + n - 1, p->values() + pos);
+		for(int j = 0; j < n - 1; ++j)
+			move_value(x->values() + j, left->values() + lc - n + 1 + j);
+		move_value(p->values() + pos, left->values() + lc - n);
+		if(!x->leaf)
+		{
+			for(int j = xc; j >= 0; --j)
+				set_child(x, j + n, child(x, j));
+			for(int j = 0; j < n; ++j)
+				set_child(x, j, child(left, lc - n + 1 + j));
+		}
+		x->count += n;
+		left->count -= n;
+	}
+
+	// Fix the underfull node of it by merging with or taking from a
+	// sibling; it follows its value. true if merged (the parent lost
+	// a value and may be underfull in turn)
+	bool merge_or_rotate(iterator& it)
+	{
+		node* x = it.n;
+		node* p = x->parent;
+		if(x->position > 0)
+		{
+			node* left = child(p, x->position - 1);
+			if(1 + left->count + x->count <= node_values)
+			{
+				it.pos += 1 + left->count;
+				merge(left, x);
+				it.n = left;
+				return true;
+			}
+		}
+		if(x->position < p->count)
+		{
+			node* right = child(p, x->position + 1);
+			if(1 + x->count + right->count <= node_values)
+			{
+				merge(x, right);
+				return true;
+			}
+			if(right->count > min_values)
+			{
+				rotate_left(x, right, (right->count - x->count) / 2);
+				return false;
+			}
+		}
+		if(x->position > 0)
+		{
+			node* left = child(p, x->position - 1);
+			const int n = (left->count - x->count) / 2;
+			rotate_right(left, x, n);
+			it.pos += n;
+		}
+		return false;
+	}
+
+	// An empty root goes: the tree is empty or one level lower
+	void shrink_root()
+	{
+		if(root->count)
+			return;
+		node* old = root;
+		if(root->leaf)
+			root = leftmost = rightmost = 0;
+		else
+		{
+			root = child(root, 0);
+			root->parent = 0;
+			root->position = 0;
+		}
+		free_node(old);
+	}
+
+	// A value was just removed at it (a leaf): rebalance up the tree.
+	// Returns the iterator to the value that followed it
+	iterator rebalance_after_erase(iterator it)
+	{
+		iterator res = it;
+		bool first = true;
+		for(;;)
+		{
+			if(it.n == root)
+			{
+				shrink_root();
+				if(!root)
+					return end();
+				break;
+			}
+			if(it.n->count >= min_values)
+				break;
+			bool merged = merge_or_rotate(it);
+			// only the leaf level moves the erased slot
+			if(first)
+			{
+				res = it;
+				first = false;
+			}
+			if(!merged)
+				break;
+			it.pos = it.n->position;
+			it.n = it.n->parent;
+		}
+		if(res.pos == res.n->count)
+		{
+			res.pos = res.n->count - 1;
+			++res;
+		}
+		return res;
+	}
+
+	//================= WHOLE TREE =============================
+	static void __erase(node* x)
+	{
+		if(!x->leaf)
+			for(int i = 0; i <= x->count; ++i)
+				if(child(x, i))
+					__erase(child(x, i));
+		free_node(x);
+	}
+
+	// Fill y, already linked in this tree, with a copy of x's subtree.
+	// At any time y is a valid node, so clear() can undo a failed copy
+	static void __copy(node* y, node* x)
+	{
+		for(int i = 0; i < x->count; ++i)
+		{
+			if(!x->leaf)
+			{
+				node* c = child(x, i)->leaf ? new_leaf() : new_internal();
+				set_child(y, i, c);
+				__copy(c, child(x, i));
+			}
+			construct(y->values() + i, x->value(i));
+			++y->count;
+		}
+		if(!x->leaf)
+		{
+			node* c = child(x, x->count)->leaf ? new_leaf()
+											   : new_internal();
+			set_child(y, x->count, c);
+			__copy(c, child(x, x->count));
+		}
+	}
+
+	template <class K>
+	iterator __lower_bound(const K& k) const
+	{
+		iterator res = end();
+		for(node* x = root; x; )
+		{
+			int i = lower_index(x, k);
+			if(i < x->count)
+				res = iterator(x, i);
+			if(x->leaf)
+				break;
+			x = child(x, i);
+		}
+		return res;
+	}
+
+	template <class K>
+	iterator __upper_bound(const K& k) const
+	{
+		iterator res = end();
+		for(node* x = root; x; )
+		{
+			int i = upper_index(x, k);
+			if(i < x->count)
+				res = iterator(x, i);
+			if(x->leaf)
+				break;
+			x = child(x, i);
+		}
+		return res;
+	}
+
+	// Stops at the first node holding k
+	template <class K>
+	iterator __find(const K& k) const
+	{
+		for(node* x = root; x; )
+		{
+			int i = lower_index(x, k);
+			if(i < x->count && !key_compare(k, key(x, i)))
+				return iterator(x, i);
+			if(x->leaf)
+				break;
+			x = child(x, i);
+		}
+		return end();
+	}
+
+public:
+	//================= CONSTRUCTOR ============================
+	btree(const Compare& comp = Compare())
+		: root(0), leftmost(0), rightmost(0), value_count(0),
+		  key_compare(comp) {}
+
+	btree(const btree& x)
+		: root(0), leftmost(0), rightmost(0), value_count(0),
+		  key_compare(x.key_compare)
+	{
+		copy_from(x);
+	}
+
+	btree& operator=(const btree& x)
+	{
+		if(this != &x)
+		{
+			btree temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~btree() {clear();}
+
+	void swap(btree& x)
+	{
+		fyj::swap(root, x.root);
+		fyj::swap(leftmost, x.leftmost);
+		fyj::swap(rightmost, x.rightmost);
+		fyj::swap(value_count, x.value_count);
+		fyj::swap(key_compare, x.key_compare);
+	}
+
+	void clear()
+	{
+		if(root)
+			__erase(root);
+		root = leftmost = rightmost = 0;
+		value_count = 0;
+	}
+
+	Compare key_comp() const {return key_compare;}
+	iterator begin() const {return iterator(leftmost, 0);}
+	iterator end() const {return iterator(rightmost, rightmost ? rightmost->count : 0);}
+	reverse_iterator rbegin() const {return reverse_iterator(end());}
+	reverse_iterator rend() const {return reverse_iterator(begin());}
+	bool empty() const {return value_count == 0;}
+	size_type size() const {return value_count;}
+	size_type max_size() const {return size_type(-1);}
+
+	//================= INSERT =================================
+	pair<iterator, bool> insert_unique(const value_type& v)
+	{
+		const Key& k = KeyOfValue()(v);
+		if(!root || after_last(k))
+			return pair<iterator, bool>(
+				insert_at(rightmost, rightmost ? rightmost->count : 0, v),
+				true);
+		node* x = root;
+		int i;
+		for(;;)
+		{
+			i = lower_index(x, k);
+			if(i < x->count && !key_compare(k, key(x, i)))
+				return pair<iterator, bool>(iterator(x, i), false);
+			if(x->leaf)
+				break;
+			x = child(x, i);
+		}
+		return pair<iterator, bool>(insert_at(x, i, v), true);
+	}
+
+	// After the values equal to v
+	iterator insert_equal(const value_type& v)
+	{
+		const Key& k = KeyOfValue()(v);
+		if(!root || after_last(k))
+			return insert_at(rightmost, rightmost ? rightmost->count : 0, v);
+		node* x = root;
+		int i;
+		for(;;)
+		{
+			i = upper_index(x, k);
+			if(x->leaf)
+				break;
+			x = child(x, i);
+		}
+		return insert_at(x, i, v);
+	}
+
+	// The hint only helps at end(): a value after all the others is
+	// appended to the rightmost leaf with no descent. Else as above
+	iterator insert_unique(const_iterator position, const value_type& v)
+	{
+		if(position == end() && (!root || after_last(KeyOfValue()(v))))
+			return insert_at(rightmost, rightmost ? rightmost->count : 0, v);
+		return insert_unique(v).first;
+	}
+
+	iterator insert_equal(const_iterator position, const value_type& v)
+	{
+		if(position == end() && (!root ||
+		   !key_compare(KeyOfValue()(v), key(rightmost, rightmost->count - 1))))
+			return insert_at(rightmost, rightmost ? rightmost->count : 0, v);
+		return insert_equal(v);
+	}
+
+	// Sorted input appends without descending
+	template <class InputIterator>
+	void insert_unique(InputIterator first, InputIterator last)
+	{
+		for(; first != last; ++first)
+			insert_unique(*first);
+	}
+
+	template <class InputIterator>
+	void insert_equal(InputIterator first, InputIterator last)
+	{
+		for(; first != last; ++first)
+			insert_equal(*first);
+	}
+
+	//================= ERASE ==================================
+	// Returns the iterator to the value after pos
+	iterator erase(iterator pos)
+	{
+		const bool internal = !pos.n->leaf;
+		if(internal)
+		{
+			// take the place of the predecessor, last of a leaf
+			iterator pred = pos;
+			--pred;
+			destroy(&*pos);
+			construct(&*pos, *pred);
+			pos = pred;
+		}
+		node* x = pos.n;
+		destroy(x->values() + pos.pos);
+		shift_left(x, pos.pos);
+		--x->count;
+		--value_count;
+		iterator res = rebalance_after_erase(pos);
+		// res is at the predecessor, now where pos was
+		if(internal)
+			++res;
+		return res;
+	}
+
+	size_type erase(const Key& k)
+	{
+		iterator first = __lower_bound(k);
+		size_type n = 0;
+		for(iterator it = first; it != end() && !key_compare(k, key(it.n, it.pos)); ++it)
+			++n;
+		for(size_type i = 0; i < n; ++i)
+			first = erase(first);
+		return n;
+	}
+
+	iterator erase(iterator first, iterator last)
+	{
+		if(first == begin() && last == end())
+		{
+			clear();
+			return end();
+		}
+		for(difference_type n = fyj::distance(first, last); n > 0; --n)
+			first = erase(first);
+		return first;
+	}
+
+	//================= LOOKUP =================================
+	iterator find(const Key& k) const {return __find(k);}
+
+	// Transparent find: k may be any type Compare can order against Key
+	// Only when Compare has "is_transparent", see "my_functors.h"
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	find(const K& k) const {return __find(k);}
+
+	iterator lower_bound(const Key& k) const {return __lower_bound(k);}
+	iterator upper_bound(const Key& k) const {return __upper_bound(k);}
+
+	pair<iterator, iterator> equal_range(const Key& k) const
+	{
+		return pair<iterator, iterator>(__lower_bound(k), __upper_bound(k));
+	}
+
+	size_type count(const Key& k) const
+	{
+		size_type n = 0;
+		for(iterator it = __lower_bound(k);
+			it != end() && !key_compare(k, key(it.n, it.pos)); ++it)
+			++n;
+		return n;
+	}
+
+private:
+	void copy_from(const btree& x)
+	{
+		if(!x.root)
+			return;
+		root = x.root->leaf ? new_leaf() : new_internal();
+		try {
+			__copy(root, x.root);
+		}
+		catch(...){
+			clear();
+			throw;
+		}
+		for(leftmost = root; !leftmost->leaf; )
+			leftmost = child(leftmost, 0);
+		for(rightmost = root; !rightmost->leaf; )
+			rightmost = child(rightmost, rightmost->count);
+		value_count = x.value_count;
+	}
+};
+
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc>
+inline bool operator==(const btree<Key, Value, KeyOfValue, Compare, Alloc>& x,
+					   const btree<Key, Value, KeyOfValue, Compare, Alloc>& y)
+{
+	return x.size() == y.size() && fyj::equal(x.begin(), x.end(), y.begin());
+}
+
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc>
+inline bool operator<(const btree<Key, Value, KeyOfValue, Compare, Alloc>& x,
+					  const btree<Key, Value, KeyOfValue, Compare, Alloc>& y)
+{
+	return fyj::lexicographical_compare(x.begin(), x.end(),
+										y.begin(), y.end());
+}
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * Map with equal keys allowed, ordered by Key, implemented by a B-tree:
+ * same interface as multimap, faster lookups and less memory for small
+ * values, see "my_btree.h"
+ * Inserts and erases invalidate iterators; no node handles
+ */
+
+#ifndef _MY_BTREE_MULTIMAP_
+#define _MY_BTREE_MULTIMAP_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_btree.h"
+
+namespace fyj
+{
+
+template <class Key, class T, class Compare = less<Key>, class Alloc = alloc>
+class btree_multimap
+{
+public:
+	typedef Key 			   key_type;
+	typedef T 				   data_type;
+	typedef T 				   mapped_type;
+	typedef pair<const Key, T> value_type;
+	typedef Compare 		   key_compare;
+
+	class value_compare : public binary_functor<value_type, value_type, bool>
+	{
+	friend class btree_multimap<Key, T, Compare, Alloc>;
+	protected:
+		Compare comp;
+		value_compare(Compare c) : comp(c){}
+	public:
+		bool operator()(const value_type& x, const value_type& y) const
+		{return comp(x.first, y.first);}
+	};
+
+private:
+	typedef btree<key_type, value_type, select1st<value_type>,
+				  key_compare, Alloc> tree_type;
+	tree_type t;
+
+public:
+	typedef typename tree_type::pointer             pointer;
+	typedef typename tree_type::const_pointer 	    const_pointer;
+	typedef typename tree_type::reference           reference;
+	typedef typename tree_type::const_reference     const_reference;
+	typedef typename tree_type::iterator            iterator;
+	typedef typename tree_type::const_iterator      const_iterator;
+	typedef typename tree_type::reverse_iterator    reverse_iterator;
+	typedef typename tree_type::const_reverse_iterator    const_reverse_iterator;
+	typedef typename tree_type::size_type 		     size_type;
+	typedef typename tree_type::difference_type      difference_type;
+
+	btree_multimap() : t(Compare()) {}
+	explicit btree_multimap(const Compare& comp) : t(comp){}
+
+	template <class InputIterator>
+	btree_multimap(InputIterator first, InputIterator last)
+		: t(Compare()) {t.insert_equal(first, last);}
+	template <class InputIterator>
+	btree_multimap(InputIterator first, InputIterator last, const Compare& comp)
+		: t(comp) {t.insert_equal(first, last);}
+
+	btree_multimap(const btree_multimap<Key, T, Compare, Alloc>& x) : t(x.t) {}
+
+	btree_multimap<Key, T, Compare, Alloc>&
+	operator=(const btree_multimap<Key, T, Compare, Alloc>& x)
+	{
+		t = x.t;
+		return *this;
+	}
+
+	key_compare key_comp() const {return t.key_comp();}
+	value_compare value_comp() const {return value_compare(t.key_comp());}
+	iterator begin() {return t.begin();}
+	const_iterator begin() const {return t.begin();}
+	iterator end() {return t.end();}
+	const_iterator end() const {return t.end();}
+	reverse_iterator rbegin() {return t.rbegin();}
+	const_reverse_iterator rbegin() const {return t.rbegin();}
+	reverse_iterator rend() {return t.rend();}
+	const_reverse_iterator rend() const {return t.rend();}
+	bool empty() const {return t.empty();}
+	size_type size() const {return t.size();}
+	size_type max_size() const {return t.max_size();}
+
+	void swap(btree_multimap<Key, T, Compare, Alloc>& x) {t.swap(x.t);}
+
+	// After the elements with an equal key
+	iterator insert(const value_type& x)
+	{
+		return t.insert_equal(x);
+	}
+
+	// O(1) search when position is end() and x goes after the last
+	// element (e.g. sorted inserts); else the same as insert(x)
+	iterator insert(const_iterator position, const value_type& x)
+	{
+		return t.insert_equal(position, x);
+	}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		t.insert_equal(first, last);
+	}
+
+	// Iterator to the element after pos
+	iterator erase(iterator pos) {return t.erase(pos);}
+	size_type erase(const key_type& x) {return t.erase(x);}
+	iterator erase(iterator first, iterator last) {return t.erase(first, last);}
+	void clear() {t.clear();}
+
+	iterator find(const key_type& x) {return t.find(x);}
+	const_iterator find(const key_type& x) const {return t.find(x);}
+	// Transparent find, see btree::find
+	template <class K>
+	typename __if_transparent<K, const_iterator, Compare>::type
+	find(const K& x) const {return t.find(x);}
+	size_type count(const key_type& x) const {return t.count(x);}
+
+	iterator lower_bound(const key_type& x) {return t.lower_bound(x);}
+	const_iterator lower_bound(const key_type& x) const {return t.lower_bound(x);}
+	iterator upper_bound(const key_type& x) {return t.upper_bound(x);}
+	const_iterator upper_bound(const key_type& x) const {return t.upper_bound(x);}
+	pair<iterator, iterator> equal_range(const key_type& x)
+	{return t.equal_range(x);}
+	pair<const_iterator, const_iterator> equal_range(const key_type& x) const
+	{
+		pair<iterator, iterator> p = t.equal_range(x);
+		return pair<const_iterator, const_iterator>(p.first, p.second);
+	}
+
+	friend bool operator==(const btree_multimap<Key, T, Compare, Alloc>& x,
+						   const btree_multimap<Key, T, Compare, Alloc>& y)
+	{
+		return x.t == y.t;
+	}
+
+	friend bool operator< (const btree_multimap<Key, T, Compare, Alloc>& x,
+						   const btree_multimap<Key, T, Compare, Alloc>& y)
+	{
+		return x.t < y.t;
+	}
+};
+
+}
+
+#endif
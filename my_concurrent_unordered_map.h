@@ -0,0 +1,460 @@
+/* Concurrent unordered_map
+ *
+ * The table is split into stripes. Each stripe is a small separate
+ * chaining hash table, same node and prime bucket design as
+ * "my_hash_table.h", with its own mutex:
+ *     # a writer only locks the stripe of its key
+ *     # a stripe grows on its own, the other stripes keep working,
+ *       so there is never a stop-the-world rehash
+ *
+ * Readers take no lock. Each stripe has a sequence number (seqlock),
+ * odd while a writer is changing it. A reader walks the chain, copies
+ * the value out, and retries if the sequence moved meanwhile.
+ * This needs Key and T to be plain data (__type_traits is_POD_type),
+ * because a reader may copy a value that is being overwritten before
+ * it notices and retries. For other types, reads lock the stripe.
+ *
+ * Memory used by a reader must stay readable even if a writer frees
+ * it at the same time, so:
+ *     # erased nodes go to a per-stripe free list and are reused,
+ *       node chunks are only freed with the map
+ *     # bucket arrays replaced by a growth are kept until the map is
+ *       destroyed (at most as much as the live arrays, as they double)
+ * Chunks and arrays come from malloc_alloc, which is thread-safe,
+ * unlike the default pool allocator.
+ *
+ * There are no iterators: an iteration would have no stable meaning
+ * while other threads write. Lookups return a copy of the value.
+ *
+ * Needs pthreads and the GCC / Clang __atomic builtins.
+ */
+
+#ifndef _MY_CONCURRENT_UNORDERED_MAP_
+#define _MY_CONCURRENT_UNORDERED_MAP_
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sched.h>
+#include "my_alloc.h"
+#include "my_construct.h"
+#include "my_type_traits.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_hash_table.h"
+
+namespace fyj
+{
+
+// __true_type only if both are __true_type
+template <class A, class B>
+struct __and_type {typedef __false_type type;};
+
+template <>
+struct __and_type<__true_type, __true_type> {typedef __true_type type;};
+
+template <class Key,
+		  class T,
+		  class HashFun = hash<Key>,
+		  class EqualKey = equal_to<Key> >
+class concurrent_unordered_map
+{
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef pair<const Key, T> value_type;
+	typedef HashFun hasher;
+	typedef EqualKey key_equal;
+	typedef size_t size_type;
+
+private:
+	typedef __hashtable_node<value_type> node;
+
+	// Lock-free reads only for plain data, see above
+	typedef typename __and_type<
+				typename __type_traits<Key>::is_POD_type,
+				typename __type_traits<T>::is_POD_type>::type plain_data;
+
+	// Nodes are carved from chunks of chunk_nodes
+	enum {chunk_nodes = 64};
+	struct node_chunk
+	{
+		node_chunk* next;
+		node nodes[chunk_nodes];
+	};
+
+	// Bucket array layout: [retired link][bucket count][buckets...]
+	// The count lives with the array, so a reader always gets a
+	// matching pair from one pointer load
+	enum {array_header = 2};
+
+	enum {cache_line = 64};
+	struct stripe
+	{
+		pthread_mutex_t lock;
+		unsigned long seq;         // odd while a writer is inside
+		node** buckets;            // points after the array header
+		size_type num_elements;
+		node* free_nodes;          // erased nodes, reused by insert
+		node_chunk* chunks;        // all chunks, freed with the map
+		node** retired;            // old arrays, freed with the map
+	};
+	// One stripe per cache line so that writers on different stripes
+	// do not bounce the same line
+	enum {stripe_size = (sizeof(stripe) + cache_line - 1)
+						/ cache_line * cache_line};
+
+	hasher hash;
+	key_equal equals;
+	size_type n_stripes;   // power of two
+	int stripe_bits;       // log2(n_stripes)
+	char* stripe_mem;      // raw allocation
+	char* stripe_base;     // stripe_mem aligned to a cache line
+
+	//================= STRIPE ===============================
+	stripe& stripe_of(size_t h) const
+	{
+		return *(stripe*)(stripe_base + (h & (n_stripes - 1)) * stripe_size);
+	}
+	stripe& stripe_at(size_type i) const
+	{
+		return *(stripe*)(stripe_base + i * stripe_size);
+	}
+
+	// The low bits of h pick the stripe, so use the rest for the bucket
+	size_type bkt_num(size_t h, node** b) const
+	{
+		return (h >> stripe_bits) % bucket_count(b);
+	}
+	static size_type bucket_count(node** b) {return (size_type)b[-1];}
+
+	static node** new_buckets(size_type n)
+	{
+		node** a = (node**)malloc_alloc::allocate(
+						(n + array_header) * sizeof(node*));
+		a[0] = 0;
+		a[1] = (node*)n;
+		for(size_type i = 0; i < n; ++i)
+			a[i + array_header] = 0;
+		return a + array_header;
+	}
+
+	//================= SEQLOCK ==============================
+	static void write_begin(stripe& s)
+	{
+		__atomic_store_n(&s.seq, s.seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+	}
+	static void write_end(stripe& s)
+	{
+		__atomic_store_n(&s.seq, s.seq + 1, __ATOMIC_RELEASE);
+	}
+	static void link(node** p, node* n)
+	{
+		__atomic_store_n(p, n, __ATOMIC_RELAXED);
+	}
+
+	//================= NODE =================================
+	node* get_node(stripe& s)
+	{
+		if(!s.free_nodes)
+		{
+			node_chunk* c = (node_chunk*)malloc_alloc::allocate(
+												sizeof(node_chunk));
+			c->next = s.chunks;
+			s.chunks = c;
+			for(int i = 0; i < chunk_nodes; ++i)
+			{
+				c->nodes[i].next = s.free_nodes;
+				s.free_nodes = c->nodes + i;
+			}
+		}
+		node* n = s.free_nodes;
+		s.free_nodes = n->next;
+		return n;
+	}
+
+	static void put_node(stripe& s, node* n)
+	{
+		destroy(&n->val);
+		link(&n->next, s.free_nodes);
+		s.free_nodes = n;
+	}
+
+	//================= GROW =================================
+	// Called with the stripe locked and inside write_begin/end
+	// The old array is retired, not freed: readers may still use it
+	void grow(stripe& s)
+	{
+		node** old = s.buckets;
+		const size_type old_n = bucket_count(old);
+		node** b = new_buckets(__next_prime(old_n + 1));
+		for(size_type i = 0; i < old_n; ++i)
+		{
+			node* first = old[i];
+			while(first)
+			{
+				node* next = first->next;
+				size_type k = bkt_num(hash(first->val.first), b);
+				link(&first->next, b[k]);
+				b[k] = first;
+				first = next;
+			}
+		}
+		__atomic_store_n(&s.buckets, b, __ATOMIC_RELEASE);
+		old[-array_header] = (node*)s.retired;
+		s.retired = old - array_header;
+	}
+
+	//================= LOOKUP ===============================
+	// Stripe locked, or called from a seqlock read
+	node* find_node(node** b, size_t h, const key_type& key,
+					size_type limit) const
+	{
+		node* cur = __atomic_load_n(&b[bkt_num(h, b)], __ATOMIC_RELAXED);
+		// A racing reader may follow a node that was just reused
+		// elsewhere; the limit keeps it from looping, the seq check
+		// then sends it back
+		for(; cur && limit; --limit)
+		{
+			if(equals(cur->val.first, key))
+				return cur;
+			cur = __atomic_load_n(&cur->next, __ATOMIC_RELAXED);
+		}
+		return 0;
+	}
+
+	// Copy the value of key into *out (if out), true if found
+	// Plain data: optimistic read, retried until no writer interfered
+	bool read(stripe& s, size_t h, const key_type& key, T* out,
+			  __true_type) const
+	{
+		for(;;)
+		{
+			const unsigned long seq0 =
+				__atomic_load_n(&s.seq, __ATOMIC_ACQUIRE);
+			if(seq0 & 1)
+			{
+				sched_yield();
+				continue;
+			}
+			node** b = __atomic_load_n(&s.buckets, __ATOMIC_ACQUIRE);
+			const size_type limit =
+				__atomic_load_n(&s.num_elements, __ATOMIC_RELAXED) + 1;
+			node* n = find_node(b, h, key, limit);
+			if(n && out)
+				*out = n->val.second;
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if(__atomic_load_n(&s.seq, __ATOMIC_RELAXED) == seq0)
+				return n != 0;
+		}
+	}
+
+	// Other types: read under the stripe lock
+	bool read(stripe& s, size_t h, const key_type& key, T* out,
+			  __false_type) const
+	{
+		pthread_mutex_lock(&s.lock);
+		node* n = find_node(s.buckets, h, key, s.num_elements + 1);
+		if(n && out)
+			*out = n->val.second;
+		pthread_mutex_unlock(&s.lock);
+		return n != 0;
+	}
+
+	// Insert obj, or overwrite the value if assign and key exists
+	// Return true if a new element was inserted
+	bool insert_aux(const value_type& obj, bool assign)
+	{
+		const size_t h = hash(obj.first);
+		stripe& s = stripe_of(h);
+		pthread_mutex_lock(&s.lock);
+		if(node* n = find_node(s.buckets, h, obj.first,
+							   s.num_elements + 1))
+		{
+			if(assign)
+			{
+				write_begin(s);
+				n->val.second = obj.second;
+				write_end(s);
+			}
+			pthread_mutex_unlock(&s.lock);
+			return false;
+		}
+		// Not linked yet, so no reader can see it being built
+		node* n = get_node(s);
+		construct(&n->val, obj);
+
+		write_begin(s);
+		if(s.num_elements + 1 > bucket_count(s.buckets))
+			grow(s);
+		node** first = s.buckets + bkt_num(h, s.buckets);
+		link(&n->next, *first);
+		link(first, n);
+		__atomic_store_n(&s.num_elements, s.num_elements + 1,
+						 __ATOMIC_RELAXED);
+		write_end(s);
+		pthread_mutex_unlock(&s.lock);
+		return true;
+	}
+
+	// Stripe locked; destroy every node and reset the chains
+	void clear_stripe(stripe& s)
+	{
+		write_begin(s);
+		node** b = s.buckets;
+		for(size_type i = 0; i < bucket_count(b); ++i)
+		{
+			node* cur = b[i];
+			while(cur)
+			{
+				node* next = cur->next;
+				put_node(s, cur);
+				cur = next;
+			}
+			link(b + i, 0);
+		}
+		__atomic_store_n(&s.num_elements, 0, __ATOMIC_RELAXED);
+		write_end(s);
+	}
+
+	// No copy: a snapshot of a map being written has no clear meaning
+	concurrent_unordered_map(const concurrent_unordered_map&);
+	concurrent_unordered_map& operator=(const concurrent_unordered_map&);
+
+public:
+	//================== CONSTRUCTOR ============================
+	// @n: expected number of elements, spread over the stripes
+	// @stripes: number of independent locks, rounded up to a power
+	//           of two; more stripes, less contention between writers
+	explicit concurrent_unordered_map(size_type n = 100,
+									  size_type stripes = 64,
+									  const hasher& hf = hasher(),
+									  const key_equal& eql = key_equal())
+		: hash(hf), equals(eql), n_stripes(1), stripe_bits(0)
+	{
+		while(n_stripes < stripes)
+		{
+			n_stripes <<= 1;
+			++stripe_bits;
+		}
+		stripe_mem = (char*)malloc_alloc::allocate(
+						n_stripes * stripe_size + cache_line);
+		stripe_base = stripe_mem + (cache_line -
+					  (size_t)stripe_mem % cache_line) % cache_line;
+		const size_type per_stripe = n / n_stripes + 1;
+		for(size_type i = 0; i < n_stripes; ++i)
+		{
+			stripe& s = stripe_at(i);
+			pthread_mutex_init(&s.lock, 0);
+			s.seq = 0;
+			s.buckets = new_buckets(__next_prime(per_stripe));
+			s.num_elements = 0;
+			s.free_nodes = 0;
+			s.chunks = 0;
+			s.retired = 0;
+		}
+	}
+
+	~concurrent_unordered_map()
+	{
+		for(size_type i = 0; i < n_stripes; ++i)
+		{
+			stripe& s = stripe_at(i);
+			clear_stripe(s);
+			malloc_alloc::deallocate(s.buckets - array_header, 0);
+			while(s.retired)
+			{
+				node** next = (node**)s.retired[0];
+				malloc_alloc::deallocate(s.retired, 0);
+				s.retired = next;
+			}
+			while(s.chunks)
+			{
+				node_chunk* next = s.chunks->next;
+				malloc_alloc::deallocate(s.chunks, 0);
+				s.chunks = next;
+			}
+			pthread_mutex_destroy(&s.lock);
+		}
+		malloc_alloc::deallocate(stripe_mem, 0);
+	}
+
+	hasher hash_fun() const {return hash;}
+	key_equal key_eq() const {return equals;}
+	size_type stripe_count() const {return n_stripes;}
+
+	//=================== COUNT ================================
+	// Exact only if no writer is running at the same time
+	size_type size() const
+	{
+		size_type result = 0;
+		for(size_type i = 0; i < n_stripes; ++i)
+			result += __atomic_load_n(&stripe_at(i).num_elements,
+									  __ATOMIC_RELAXED);
+		return result;
+	}
+	bool empty() const {return size() == 0;}
+
+	//=================== FIND =================================
+	// Copy the value of key into value; false if key is missing
+	bool find(const key_type& key, T& value) const
+	{
+		const size_t h = hash(key);
+		return read(stripe_of(h), h, key, &value, plain_data());
+	}
+
+	size_type count(const key_type& key) const
+	{
+		const size_t h = hash(key);
+		return read(stripe_of(h), h, key, (T*)0, plain_data()) ? 1 : 0;
+	}
+
+	//=================== INSERT & ERASE ========================
+	// false (and no change) if the key is already there
+	bool insert(const value_type& obj) {return insert_aux(obj, false);}
+
+	// Insert, or overwrite the value of an existing key
+	// Return true if a new element was inserted
+	bool insert_or_assign(const key_type& key, const T& value)
+	{
+		return insert_aux(value_type(key, value), true);
+	}
+
+	size_type erase(const key_type& key)
+	{
+		const size_t h = hash(key);
+		stripe& s = stripe_of(h);
+		pthread_mutex_lock(&s.lock);
+		node** prev = s.buckets + bkt_num(h, s.buckets);
+		while(*prev && !equals((*prev)->val.first, key))
+			prev = &(*prev)->next;
+		node* n = *prev;
+		if(n)
+		{
+			write_begin(s);
+			link(prev, n->next);
+			__atomic_store_n(&s.num_elements, s.num_elements - 1,
+							 __ATOMIC_RELAXED);
+			write_end(s);
+			put_node(s, n);
+		}
+		pthread_mutex_unlock(&s.lock);
+		return n ? 1 : 0;
+	}
+
+	// Stripes are cleared one after the other, not all at once
+	void clear()
+	{
+		for(size_type i = 0; i < n_stripes; ++i)
+		{
+			stripe& s = stripe_at(i);
+			pthread_mutex_lock(&s.lock);
+			clear_stripe(s);
+			pthread_mutex_unlock(&s.lock);
+		}
+	}
+};
+
+} // end of namespace
+
+#endif
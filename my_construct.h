@@ -26,23 +26,6 @@ void destroy(T* p)
 	p->~T();
 }
 
-/* Destroy: 2nd version;
- * Passed by two iterators: first, second;
- * To delete objects in range [first, second] by destructor
- *
- * If destructor of each object is:
- *    - trivial destructor     -> do nothing (to save time)
- *    - non-trivial destructor -> call 1st version destroy
- *
- * "trivial destructor" = no much business when destruct the object...
- * which is juged by _type_traits<T>
- */
-template <class ForwardIterator>
-void destroy(ForwardIterator first, ForwardIterator last)
-{
-	__destroy(first, last, value_type(first)); //value_type defined in my_iterator.h
-}
-
 /* __destroy
  * See if value_type(T) has trivial_destructor:
  *     - yes --> trivial_destructor = __true_type
@@ -76,6 +59,23 @@ void __destroy_aux(ForwardIterator first, ForwardIterator last, __false_type)
 		destroy(&*first);
 }
 
+/* Destroy: 2nd version;
+ * Passed by two iterators: first, second;
+ * To delete objects in range [first, second] by destructor
+ *
+ * If destructor of each object is:
+ *    - trivial destructor     -> do nothing (to save time)
+ *    - non-trivial destructor -> call 1st version destroy
+ *
+ * "trivial destructor" = no much business when destruct the object...
+ * which is juged by _type_traits<T>
+ */
+template <class ForwardIterator>
+void destroy(ForwardIterator first, ForwardIterator last)
+{
+	__destroy(first, last, value_type(first)); //value_type defined in my_iterator.h
+}
+
 /* Destroy: 3rd version -- special cases
  * Do nothing for the following
  */
@@ -0,0 +1,298 @@
+/* Cuckoo filter
+ *
+ * Like a Bloom filter (false positives, no false negatives) but keys
+ * can be erased. It stores a 16-bit fingerprint of each key in one of
+ * two buckets; the other bucket of a fingerprint is found from the
+ * fingerprint alone (i2 = hash(fp) - i1 mod n), so a full bucket can move
+ * an entry to its other bucket, cuckoo style, without the key.
+ *
+ * A bucket is one cache line: 32 fingerprints of 16 bits, so a lookup
+ * reads at most two lines. With SSE2 a bucket is searched with four
+ * 8-lane compares. Fingerprint 0 marks a free entry.
+ * The table can be filled to ~95% (~17 bits per key); false positives
+ * are about 2 * 32 / 65535 = 0.1%.
+ *
+ * erase() must only be called for keys that were inserted, or it may
+ * remove the fingerprint of another key.
+ */
+
+#ifndef _MY_CUCKOO_FILTER_
+#define _MY_CUCKOO_FILTER_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include <stdint.h>
+#include "my_algo.h"
+#include "my_functors.h"
+#include "my_int_hash_table.h" // for __int_hash_mix, __int_hash_range
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+namespace fyj
+{
+
+// Entries moved before an insert gives up
+static const int __cuckoo_max_kicks = 500;
+// Fill ratio the table is sized for
+static const float __cuckoo_load = 0.95f;
+
+template <class Key,
+		  class HashFun = hash<Key>,
+		  class Alloc = alloc>
+class cuckoo_filter
+{
+public:
+	typedef Key key_type;
+	typedef HashFun hasher;
+	typedef size_t size_type;
+
+private:
+	typedef simple_alloc<char, Alloc> data_allocator;
+	enum {cache_line = 64};
+	enum {bucket_slots = 32};
+
+	struct bucket {uint16_t fp[bucket_slots];};
+
+	hasher hash;
+	char* mem;			// as allocated
+	bucket* buckets;	// mem aligned to a cache line
+	size_type num_buckets;
+	size_type num_keys;
+	size_type max_keys;
+	uint32_t kick_state;	// for victim choice
+
+	// An entry evicted by a failed insert: kept so it is never lost
+	bool has_victim;
+	uint16_t victim_fp;
+	size_type victim_bucket;
+
+	size_type mem_size() const
+	{return num_buckets * sizeof(bucket) + cache_line;}
+
+	static size_type buckets_for(size_type n)
+	{return size_type(n / (bucket_slots * __cuckoo_load)) + 1;}
+
+	void allocate(size_type n_buckets)
+	{
+		num_buckets = n_buckets;
+		mem = data_allocator::allocate(mem_size());
+		buckets = (bucket*)(mem + (cache_line -
+				  (size_t)mem % cache_line) % cache_line);
+		clear();
+	}
+
+	void split(const key_type& key, size_type& i, uint16_t& fp) const
+	{
+		size_t k = hash(key);
+		uint64_t h = __int_hash_mix(k);
+		if(sizeof(size_t) < sizeof(uint64_t))
+			h = (h << 32) | __int_hash_mix(k ^ 0x9e3779b9UL);
+		fp = uint16_t(h);
+		if(fp == 0)
+			fp = 1;
+		i = size_type(((h >> 32) * num_buckets) >> 32);
+	}
+
+	// r - i mod n, with r from fp only: alt_bucket(alt_bucket(i)) == i
+	size_type alt_bucket(size_type i, uint16_t fp) const
+	{
+		size_type r = __int_hash_range(__int_hash_mix(fp), num_buckets);
+		return r >= i ? r - i : r + num_buckets - i;
+	}
+
+	// Bit j set if entry j of bucket i equals fp
+	uint32_t match(size_type i, uint16_t fp) const
+	{
+		const uint16_t* p = buckets[i].fp;
+#if defined(__SSE2__)
+		__m128i v = _mm_set1_epi16(short(fp));
+		const __m128i* q = (const __m128i*)p;
+		__m128i c0 = _mm_cmpeq_epi16(_mm_load_si128(q), v);
+		__m128i c1 = _mm_cmpeq_epi16(_mm_load_si128(q + 1), v);
+		__m128i c2 = _mm_cmpeq_epi16(_mm_load_si128(q + 2), v);
+		__m128i c3 = _mm_cmpeq_epi16(_mm_load_si128(q + 3), v);
+		// pack the 16-bit masks to bytes: one movemask bit per entry
+		uint32_t lo = _mm_movemask_epi8(_mm_packs_epi16(c0, c1));
+		uint32_t hi = _mm_movemask_epi8(_mm_packs_epi16(c2, c3));
+		return lo | (hi << 16);
+#else
+		uint32_t r = 0;
+		for(int j = 0; j < bucket_slots; ++j)
+			r |= uint32_t(p[j] == fp) << j;
+		return r;
+#endif
+	}
+
+	static int first_bit(uint32_t m)
+	{
+#if defined(__GNUC__)
+		return __builtin_ctz(m);
+#else
+		int j = 0;
+		while(!(m & 1))
+			m >>= 1, ++j;
+		return j;
+#endif
+	}
+
+	bool put(size_type i, uint16_t fp)
+	{
+		uint32_t m = match(i, 0);
+		if(!m)
+			return false;
+		buckets[i].fp[first_bit(m)] = fp;
+		return true;
+	}
+
+	uint32_t next_random()
+	{
+		kick_state = kick_state * 1103515245U + 12345U;
+		return kick_state >> 16;
+	}
+
+public:
+	// Sized for max_n keys
+	explicit cuckoo_filter(size_type max_n, const hasher& hf = hasher())
+		: hash(hf), num_keys(0), max_keys(max_n), kick_state(1)
+	{
+		allocate(buckets_for(max_n));
+	}
+
+	cuckoo_filter(const cuckoo_filter& x)
+		: hash(x.hash), num_keys(x.num_keys), max_keys(x.max_keys),
+		  kick_state(x.kick_state)
+	{
+		allocate(x.num_buckets);	// clears num_keys
+		copy(x.buckets, x.buckets + num_buckets, buckets);
+		num_keys = x.num_keys;
+		has_victim = x.has_victim;
+		victim_fp = x.victim_fp;
+		victim_bucket = x.victim_bucket;
+	}
+
+	cuckoo_filter& operator=(const cuckoo_filter& x)
+	{
+		if(this != &x)
+		{
+			cuckoo_filter temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~cuckoo_filter() {data_allocator::deallocate(mem, mem_size());}
+
+	void swap(cuckoo_filter& x)
+	{
+		fyj::swap(hash, x.hash);
+		fyj::swap(mem, x.mem);
+		fyj::swap(buckets, x.buckets);
+		fyj::swap(num_buckets, x.num_buckets);
+		fyj::swap(num_keys, x.num_keys);
+		fyj::swap(max_keys, x.max_keys);
+		fyj::swap(kick_state, x.kick_state);
+		fyj::swap(has_victim, x.has_victim);
+		fyj::swap(victim_fp, x.victim_fp);
+		fyj::swap(victim_bucket, x.victim_bucket);
+	}
+
+	// Number of keys the filter was sized for
+	size_type capacity() const {return max_keys;}
+	size_type size() const {return num_keys;}
+	size_type size_in_bytes() const {return num_buckets * sizeof(bucket);}
+
+	void clear()
+	{
+		for(size_type i = 0; i < num_buckets; ++i)
+			for(int j = 0; j < bucket_slots; ++j)
+				buckets[i].fp[j] = 0;
+		num_keys = 0;
+		has_victim = false;
+	}
+
+	// Empty filter sized for max_n keys
+	void reset(size_type max_n)
+	{
+		data_allocator::deallocate(mem, mem_size());
+		max_keys = max_n;
+		allocate(buckets_for(max_n));
+	}
+
+	// false if the filter is full: that key is kept aside and still
+	// answered "maybe", but every later insert fails and stores
+	// nothing, so those keys may be answered "no". reset() it bigger
+	bool insert(const key_type& key)
+	{
+		if(has_victim)
+			return false;
+		size_type i;
+		uint16_t fp;
+		split(key, i, fp);
+		++num_keys;
+		if(put(i, fp) || put(alt_bucket(i, fp), fp))
+			return true;
+
+		// Both full: move random entries to their other bucket
+		if(next_random() & 1)
+			i = alt_bucket(i, fp);
+		for(int n = 0; n < __cuckoo_max_kicks; ++n)
+		{
+			int j = next_random() % bucket_slots;
+			fyj::swap(fp, buckets[i].fp[j]);
+			i = alt_bucket(i, fp);
+			if(put(i, fp))
+				return true;
+		}
+		has_victim = true;
+		victim_fp = fp;
+		victim_bucket = i;
+		return false;
+	}
+
+	// false: key was never inserted; true: key was probably inserted
+	bool possibly_contains(const key_type& key) const
+	{
+		size_type i;
+		uint16_t fp;
+		split(key, i, fp);
+		size_type i2 = alt_bucket(i, fp);
+		if(match(i, fp) || match(i2, fp))
+			return true;
+		return has_victim && victim_fp == fp
+			&& (victim_bucket == i || victim_bucket == i2);
+	}
+
+	// Remove one fingerprint of key, which must have been inserted
+	void erase(const key_type& key)
+	{
+		size_type i;
+		uint16_t fp;
+		split(key, i, fp);
+		size_type i2 = alt_bucket(i, fp);
+		if(has_victim && victim_fp == fp
+		   && (victim_bucket == i || victim_bucket == i2))
+		{
+			has_victim = false;
+			--num_keys;
+			return;
+		}
+		uint32_t m = match(i, fp);
+		if(!m)
+		{
+			i = i2;
+			m = match(i, fp);
+		}
+		if(!m)
+			return;
+		buckets[i].fp[first_bit(m)] = 0;
+		--num_keys;
+		// room again for the evicted entry
+		if(has_victim && put(victim_bucket, victim_fp))
+			has_victim = false;
+	}
+};
+
+} // end of namespace
+
+#endif
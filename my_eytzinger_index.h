@@ -0,0 +1,234 @@
+/* Static search index over sorted keys, in Eytzinger (BFS) order
+ *
+ * Built once from a key range, then read only. lower_bound of
+ * "my_algo.h" halves a sorted array: on a large one every probe is a
+ * cache miss at an unpredictable address, and every comparison an
+ * unpredictable branch. Here the keys are laid out as an implicit
+ * complete binary search tree, stored level by level (slot k has its
+ * children in 2k and 2k + 1), so:
+ *     # the first levels of the tree share a few cache lines, which
+ *       stay hot across queries
+ *     # the 2^d descendants of slot k at depth d are contiguous: one
+ *       prefetch per step fetches the line needed d steps later, so
+ *       the misses of a query overlap instead of adding up
+ *     # the descent has no data dependent branch: k = 2k + (key < x),
+ *       and the answer is recovered from the bits of k at the end
+ * Queries return ranks: positions in the sorted order of the keys
+ * (e.g. of a payload stored in a sorted vector), size() if none.
+ * Memory: one key plus one size_t rank per key.
+ */
+
+#ifndef _MY_EYTZINGER_INDEX_
+#define _MY_EYTZINGER_INDEX_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_vector.h"
+
+namespace fyj
+{
+
+// Size of the lines the prefetches are sized for
+static const size_t __eytzinger_line_bytes = 64;
+
+template <class Key, class Compare = less<Key>, class Alloc = alloc>
+class eytzinger_index
+{
+public:
+	typedef Key     key_type;
+	typedef Key     value_type;
+	typedef Compare key_compare;
+	typedef size_t  size_type;
+
+private:
+	vector<Key, Alloc> store;
+	vector<size_type, Alloc> ranks;		// ranks[k]: rank of the key of slot k
+	Key* base;							// slot k is base[k], 1 <= k <= n
+	size_type n;
+	size_type stride;					// slots per line, a power of 2
+	Compare comp;
+
+	// Room for slots 0 .. m and a line more, so that base can start on
+	// a line boundary: then the descendants of k at depth log2(stride),
+	// slots k * stride .., share one line
+	void init_storage(size_type m, const Key& fill)
+	{
+		n = m;
+		stride = 2;
+		while(stride * 2 * sizeof(Key) <= __eytzinger_line_bytes)
+			stride *= 2;
+		vector<Key, Alloc> temp(n + 1 + stride, fill);
+		store.swap(temp);
+		vector<size_type, Alloc> temp_ranks(n + 1, size_type(0));
+		ranks.swap(temp_ranks);
+		base = store.begin();
+		for(size_type i = 0; i < stride; ++i)
+			if((size_t)(store.begin() + i) % __eytzinger_line_bytes == 0)
+			{
+				base = store.begin() + i;
+				break;
+			}
+	}
+
+	// In order walk of the subtree of slot k, filled from sorted[i]:
+	// returns the next i
+	size_type layout(const Key* sorted, size_type i, size_type k)
+	{
+		if(k <= n)
+		{
+			i = layout(sorted, i, 2 * k);
+			base[k] = sorted[i];
+			ranks.begin()[k] = i;
+			i = layout(sorted, i + 1, 2 * k + 1);
+		}
+		return i;
+	}
+
+	void prefetch(size_type k) const
+	{
+#if defined(__GNUC__)
+		__builtin_prefetch(base + k * stride);
+#endif
+	}
+
+	// The descent turned right (bit 1) after the answer, then left
+	// (bit 0) at the answer: drop the trailing ones and that zero.
+	// 0 if it never turned left
+	static size_type answer(size_type k)
+	{
+#if defined(__GNUC__)
+		return k >> __builtin_ffsll(~(unsigned long long)k);
+#else
+		while(k & 1)
+			k >>= 1;
+		return k >> 1;
+#endif
+	}
+
+	void build(vector<Key, Alloc>& keys)
+	{
+		const size_type m = keys.size();
+		if(m == 0)
+		{
+			n = 0;
+			return;
+		}
+		Key* first = keys.begin();
+		Key* last = keys.end();
+		size_type i = 1;
+		while(i < m && !comp(first[i], first[i - 1]))
+			++i;
+		if(i < m)
+		{
+			vector<Key, Alloc> buffer(m, first[0]);
+			stable_sort(first, last, buffer.begin(), comp);
+		}
+		init_storage(m, first[0]);
+		layout(first, 0, 1);
+	}
+
+public:
+	eytzinger_index() : base(0), n(0), stride(2), comp() {}
+
+	// Keys in any order (sorted first if need be); equal keys are kept
+	template <class InputIterator>
+	eytzinger_index(InputIterator first, InputIterator last,
+					const Compare& c = Compare())
+		: base(0), n(0), stride(2), comp(c)
+	{
+		vector<Key, Alloc> keys;
+		for(; first != last; ++first)
+			keys.push_back(*first);
+		build(keys);
+	}
+
+	// The copy gets its own line aligned base
+	eytzinger_index(const eytzinger_index& x)
+		: base(0), n(0), stride(2), comp(x.comp)
+	{
+		if(x.n)
+		{
+			init_storage(x.n, x.base[1]);
+			fyj::copy(x.base + 1, x.base + n + 1, base + 1);
+			fyj::copy(x.ranks.begin(), x.ranks.end(), ranks.begin());
+		}
+	}
+
+	eytzinger_index& operator=(const eytzinger_index& x)
+	{
+		if(this != &x)
+		{
+			eytzinger_index temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	// Vectors swap their buffers, so base stays valid
+	void swap(eytzinger_index& x)
+	{
+		store.swap(x.store);
+		ranks.swap(x.ranks);
+		fyj::swap(base, x.base);
+		fyj::swap(n, x.n);
+		fyj::swap(stride, x.stride);
+		fyj::swap(comp, x.comp);
+	}
+
+	size_type size() const {return n;}
+	bool empty() const {return n == 0;}
+	key_compare key_comp() const {return comp;}
+
+	// Rank of the first key not less than x
+	size_type lower_bound(const Key& x) const
+	{
+		size_type k = 1;
+		while(k <= n)
+		{
+			prefetch(k);
+			k = 2 * k + comp(base[k], x);
+		}
+		k = answer(k);
+		return k ? ranks.begin()[k] : n;
+	}
+
+	// Rank of the first key greater than x
+	size_type upper_bound(const Key& x) const
+	{
+		size_type k = 1;
+		while(k <= n)
+		{
+			prefetch(k);
+			k = 2 * k + !comp(x, base[k]);
+		}
+		k = answer(k);
+		return k ? ranks.begin()[k] : n;
+	}
+
+	// Rank of the first key equal to x, size() if none
+	size_type find(const Key& x) const
+	{
+		size_type k = 1;
+		while(k <= n)
+		{
+			prefetch(k);
+			k = 2 * k + comp(base[k], x);
+		}
+		k = answer(k);
+		return (k && !comp(x, base[k])) ? ranks.begin()[k] : n;
+	}
+
+	bool contains(const Key& x) const {return find(x) != n;}
+
+	size_type count(const Key& x) const
+	{
+		return upper_bound(x) - lower_bound(x);
+	}
+};
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,160 @@
+/* Filter in front of a hash container
+ *
+ * filtered_hash_container wraps an unordered_set / unordered_map (or
+ * any container with the same insert / find / erase interface) and
+ * keeps every key also in a filter, blocked_bloom_filter by default
+ * or cuckoo_filter. A lookup asks the filter first: when it answers
+ * "no", the container (its buckets and chains) is never read. Worth
+ * it when most lookups miss.
+ *
+ * The filter is sized for the container; when the container outgrows
+ * it, or a cuckoo filter is full, it is rebuilt twice as large from
+ * the container's keys, again until every key fits. If they still do
+ * not at __filter_max_grow times the size (a cuckoo filter cannot
+ * hold many keys of one hash), the filter is bypassed, and lookups go
+ * to the container, until the container outgrows it.
+ * A Bloom filter cannot drop erased keys, they only add false
+ * positives until the next rebuild; a cuckoo filter drops them.
+ */
+
+#ifndef _MY_FILTERED_HASH_CONTAINER_
+#define _MY_FILTERED_HASH_CONTAINER_
+
+#include <stddef.h>
+#include "my_pair.h"
+#include "my_bloom_filter.h"
+
+namespace fyj
+{
+
+// Largest filter, as a multiple of the container size, a rebuild tries
+static const size_t __filter_max_grow = 8;
+
+// Key of an element: first of a map pair, the element of a set
+template <class Key, class T>
+inline const Key& __filter_key(const pair<const Key, T>& v) {return v.first;}
+
+template <class Value>
+inline const Value& __filter_key(const Value& v) {return v;}
+
+// @Container: hash container, e.g. unordered_set<Key>
+// @Filter: blocked_bloom_filter or cuckoo_filter of the key type
+template <class Container,
+		  class Filter = blocked_bloom_filter<typename Container::key_type,
+											  typename Container::hasher> >
+class filtered_hash_container
+{
+public:
+	typedef Container container_type;
+	typedef Filter filter_type;
+	typedef typename Container::key_type key_type;
+	typedef typename Container::value_type value_type;
+	typedef typename Container::size_type size_type;
+	typedef typename Container::iterator iterator;
+	typedef typename Container::const_iterator const_iterator;
+
+private:
+	Container c;
+	Filter f;
+	bool filtered;	// every key is in f, else f is bypassed
+
+	// Refill the filter from the container, sized for n keys, or
+	// twice as many while an insert fails (a cuckoo filter may fill up
+	// early): a key missing from the filter would be answered absent
+	void rebuild_filter(size_type n)
+	{
+		if(n < c.size())
+			n = c.size();
+		for(;; n *= 2)
+		{
+			f.reset(n);
+			const_iterator it = cont().begin();
+			while(it != cont().end() && f.insert(__filter_key(*it)))
+				++it;
+			filtered = it == cont().end();
+			if(filtered || n > __filter_max_grow * c.size())
+				return;
+		}
+	}
+
+	bool maybe(const key_type& key) const
+	{return !filtered || f.possibly_contains(key);}
+
+	const Container& cont() const {return c;}
+
+	void add_key(const key_type& key)
+	{
+		if(c.size() > f.capacity() || (filtered && !f.insert(key)))
+			rebuild_filter(2 * c.size());
+	}
+
+public:
+	explicit filtered_hash_container(size_type n = 100)
+		: c(n), f(n), filtered(true) {}
+
+	// Filter the elements of x
+	explicit filtered_hash_container(const Container& x)
+		: c(x), f(x.size() + 100), filtered(true)
+	{
+		rebuild_filter(x.size() + 100);
+	}
+
+	size_type size() const {return c.size();}
+	bool empty() const {return c.empty();}
+
+	iterator begin() {return c.begin();}
+	iterator end() {return c.end();}
+	const_iterator begin() const {return c.begin();}
+	const_iterator end() const {return c.end();}
+
+	// Read access to the parts; the container must not be
+	// changed behind the filter
+	const Container& container() const {return c;}
+	const Filter& filter() const {return f;}
+
+public:
+	pair<iterator, bool> insert(const value_type& obj)
+	{
+		pair<iterator, bool> p = c.insert(obj);
+		if(p.second)
+			add_key(__filter_key(obj));
+		return p;
+	}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		for(; first != last; ++first)
+			insert(*first);
+	}
+
+	iterator find(const key_type& key)
+	{return maybe(key) ? c.find(key) : c.end();}
+
+	const_iterator find(const key_type& key) const
+	{return maybe(key) ? cont().find(key) : cont().end();}
+
+	size_type count(const key_type& key) const
+	{return maybe(key) ? c.count(key) : 0;}
+
+	size_type erase(const key_type& key)
+	{
+		if(!maybe(key))
+			return 0;
+		size_type n = c.erase(key);
+		if(n && filtered)
+			f.erase(key);
+		return n;
+	}
+
+	void clear()
+	{
+		c.clear();
+		f.clear();
+		filtered = true;
+	}
+};
+
+} // end of namespace
+
+#endif
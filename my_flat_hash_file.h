@@ -0,0 +1,287 @@
+/* Read-only hash map stored in a flat file, served straight from mmap
+ *
+ * write() lays a map out with offsets instead of pointers:
+ *     header | bucket offsets (num_buckets + 1) | entries
+ * Entries are {key, value} pairs stored contiguously, grouped by
+ * bucket: the entries of bucket b are [offsets[b], offsets[b+1]).
+ * The file is position independent, so open() only mmaps it and
+ * checks the header, in O(1), and find() reads the mapping (checking
+ * the two offsets of its bucket): no parsing, no allocation, and
+ * processes mapping the same file share its pages.
+ *
+ * Key and T must be plain data (__type_traits is_POD_type), they are
+ * copied byte for byte. HashFun must give the same hash in the writer
+ * and in the readers. The file uses the native byte order.
+ *
+ * Needs POSIX open / mmap.
+ */
+
+#ifndef _MY_FLAT_HASH_FILE_
+#define _MY_FLAT_HASH_FILE_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "my_type_traits.h"
+#include "my_functors.h"
+#include "my_algo.h"
+#include "my_vector.h"
+#include "my_hash_table.h" // for __next_prime
+
+namespace fyj
+{
+
+static const char __flat_hash_magic[8] = {'F','Y','J','H','A','S','H','1'};
+
+// Entries start on a cache line
+static const uint64_t __flat_hash_align = 64;
+
+struct __flat_hash_header
+{
+	char magic[8];
+	uint32_t key_size;
+	uint32_t value_size;
+	uint64_t entry_size;
+	uint64_t num_elements;
+	uint64_t num_buckets;
+	uint64_t bucket_offset;		// from the start of the file
+	uint64_t entry_offset;
+	uint64_t file_size;
+};
+
+template <class Key, class T>
+struct __flat_hash_entry
+{
+	Key first;
+	T second;
+};
+
+// Only declared for __true_type: non plain data fails to compile
+inline void __flat_hash_require_pod(__true_type) {}
+
+template <class Key,
+		  class T,
+		  class HashFun = hash<Key>,
+		  class EqualKey = equal_to<Key> >
+class flat_hash_map_file
+{
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef __flat_hash_entry<Key, T> value_type;
+	typedef const value_type* const_iterator;
+	typedef HashFun hasher;
+	typedef EqualKey key_equal;
+	typedef size_t size_type;
+
+private:
+	hasher hash;
+	key_equal equals;
+
+	void* base;
+	size_t length;
+	const __flat_hash_header* header;
+	const uint64_t* offsets;
+	const value_type* entries;
+
+	// No copy: the mapping is owned
+	flat_hash_map_file(const flat_hash_map_file&);
+	flat_hash_map_file& operator=(const flat_hash_map_file&);
+
+	static uint64_t align_up(uint64_t n)
+	{return (n + __flat_hash_align - 1) / __flat_hash_align * __flat_hash_align;}
+
+	static bool write_all(FILE* f, const void* p, size_t n)
+	{return n == 0 || fwrite(p, 1, n, f) == n;}
+
+	// Check the header against the file and this instantiation, sizes
+	// for overflow before they are computed. O(1): the bucket offsets
+	// are not read here, find() checks those of the bucket it scans
+	bool valid(const __flat_hash_header* h, size_t len) const
+	{
+		const uint64_t max = ~uint64_t(0);
+		if(len < sizeof(__flat_hash_header)
+		   || memcmp(h->magic, __flat_hash_magic, 8) != 0
+		   || h->key_size != sizeof(Key)
+		   || h->value_size != sizeof(T)
+		   || h->entry_size != sizeof(value_type)
+		   || h->file_size != len
+		   || h->num_buckets == 0
+		   || h->bucket_offset < sizeof(__flat_hash_header)
+		   || h->bucket_offset % sizeof(uint64_t) != 0
+		   || h->entry_offset % __flat_hash_align != 0
+		   || h->num_buckets >= max / sizeof(uint64_t)
+		   || h->num_elements > max / sizeof(value_type))
+			return false;
+		uint64_t bucket_bytes = (h->num_buckets + 1) * sizeof(uint64_t);
+		uint64_t entry_bytes = h->num_elements * sizeof(value_type);
+		return h->bucket_offset <= h->entry_offset
+			&& bucket_bytes <= h->entry_offset - h->bucket_offset
+			&& h->entry_offset <= len
+			&& entry_bytes <= len - h->entry_offset;
+	}
+
+public:
+	flat_hash_map_file(const hasher& hf = hasher(),
+					   const key_equal& keq = key_equal())
+		: hash(hf), equals(keq), base(0), length(0),
+		  header(0), offsets(0), entries(0)
+	{
+		__flat_hash_require_pod(typename __type_traits<Key>::is_POD_type());
+		__flat_hash_require_pod(typename __type_traits<T>::is_POD_type());
+	}
+
+	~flat_hash_map_file() {close();}
+
+	// Map the file at path, returns false if it cannot be read
+	// or was written for other Key / T types
+	bool open(const char* path)
+	{
+		close();
+		int fd = ::open(path, O_RDONLY);
+		if(fd < 0)
+			return false;
+		struct stat st;
+		if(fstat(fd, &st) != 0 || st.st_size <= 0)
+		{
+			::close(fd);
+			return false;
+		}
+		size_t len = size_t(st.st_size);
+		void* p = mmap(0, len, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd); // the mapping keeps the file
+		if(p == MAP_FAILED)
+			return false;
+		const __flat_hash_header* h =
+			static_cast<const __flat_hash_header*>(p);
+		if(!valid(h, len))
+		{
+			munmap(p, len);
+			return false;
+		}
+		base = p;
+		length = len;
+		header = h;
+		const char* bytes = static_cast<const char*>(p);
+		offsets = reinterpret_cast<const uint64_t*>(bytes + h->bucket_offset);
+		entries = reinterpret_cast<const value_type*>(bytes + h->entry_offset);
+		return true;
+	}
+
+	void close()
+	{
+		if(base)
+			munmap(base, length);
+		base = 0;
+		length = 0;
+		header = 0;
+		offsets = 0;
+		entries = 0;
+	}
+
+	bool is_open() const {return base != 0;}
+
+	size_type size() const {return header ? size_type(header->num_elements) : 0;}
+	bool empty() const {return size() == 0;}
+	size_type bucket_count() const
+	{return header ? size_type(header->num_buckets) : 0;}
+
+	const_iterator begin() const {return entries;}
+	const_iterator end() const {return entries + size();}
+
+	// Value of key in the mapping, 0 if absent
+	const T* find(const key_type& key) const
+	{
+		if(!header)
+			return 0;
+		size_type b = hash(key) % header->num_buckets;
+		// A corrupt file must not send the scan out of the entries
+		if(offsets[b] > offsets[b + 1]
+		   || offsets[b + 1] > header->num_elements)
+			return 0;
+		const value_type* first = entries + offsets[b];
+		const value_type* last = entries + offsets[b + 1];
+		for(; first != last; ++first)
+		{
+			if(equals(first->first, key))
+				return &first->second;
+		}
+		return 0;
+	}
+
+	size_type count(const key_type& key) const {return find(key) ? 1 : 0;}
+
+public:
+	// Write [first, last), a range of pairs with .first / .second
+	// (e.g. the iterators of an unordered_map), to path.
+	// Each key should appear once; find() returns the first written
+	template <class ForwardIterator>
+	static bool write(const char* path, ForwardIterator first,
+					  ForwardIterator last, const hasher& hf = hasher())
+	{
+		__flat_hash_require_pod(typename __type_traits<Key>::is_POD_type());
+		__flat_hash_require_pod(typename __type_traits<T>::is_POD_type());
+
+		uint64_t n = 0;
+		for(ForwardIterator it = first; it != last; ++it)
+			++n;
+		uint64_t nb = __next_prime((unsigned long)n);
+
+		// Counting sort by bucket: offsets[b + 1] counts bucket b first
+		vector<uint64_t> offsets(size_t(nb + 1), uint64_t(0));
+		for(ForwardIterator it = first; it != last; ++it)
+			++offsets[hf(it->first) % nb + 1];
+		for(uint64_t b = 0; b < nb; ++b)
+			offsets[b + 1] += offsets[b];
+
+		vector<uint64_t> next(offsets);
+		const value_type zero = value_type();
+		vector<value_type> entries(size_t(n), zero);
+		for(ForwardIterator it = first; it != last; ++it)
+		{
+			value_type& e = entries[next[hf(it->first) % nb]++];
+			e.first = it->first;
+			e.second = it->second;
+		}
+
+		__flat_hash_header h;
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, __flat_hash_magic, 8);
+		h.key_size = sizeof(Key);
+		h.value_size = sizeof(T);
+		h.entry_size = sizeof(value_type);
+		h.num_elements = n;
+		h.num_buckets = nb;
+		h.bucket_offset = sizeof(h);
+		h.entry_offset = align_up(h.bucket_offset + (nb + 1) * sizeof(uint64_t));
+		h.file_size = h.entry_offset + n * sizeof(value_type);
+
+		FILE* f = fopen(path, "wb");
+		if(!f)
+			return false;
+		char pad[__flat_hash_align];
+		memset(pad, 0, sizeof(pad));
+		size_t pad_len = size_t(h.entry_offset - h.bucket_offset
+								- (nb + 1) * sizeof(uint64_t));
+		bool ok = write_all(f, &h, sizeof(h))
+			&& write_all(f, offsets.begin(), size_t(nb + 1) * sizeof(uint64_t))
+			&& write_all(f, pad, pad_len)
+			&& write_all(f, entries.begin(), size_t(n) * sizeof(value_type));
+		return fclose(f) == 0 && ok;
+	}
+
+	// Write a whole container, e.g. an unordered_map<Key, T>
+	template <class Container>
+	static bool write(const char* path, const Container& c,
+					  const hasher& hf = hasher())
+	{return write(path, c.begin(), c.end(), hf);}
+};
+
+} // end of namespace
+
+#endif
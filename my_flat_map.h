@@ -0,0 +1,166 @@
+/**
+ * Map with unique keys ordered by Key, kept in a sorted vector:
+ * same interface as map, the fastest lookups and least memory of the
+ * ordered maps, but O(n) single inserts and erases, see "my_flat_tree.h"
+ * Fill it with the range constructor or range insert.
+ * value_type is pair<Key, T>: the key is not const, do not change it.
+ * Inserts and erases invalidate iterators; no node handles
+ */
+
+#ifndef _MY_FLAT_MAP_
+#define _MY_FLAT_MAP_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_flat_tree.h"
+
+namespace fyj
+{
+
+template <class Key, class T, class Compare = less<Key>, class Alloc = alloc>
+class flat_map
+{
+public:
+	typedef Key 			   key_type;
+	typedef T 				   data_type;
+	typedef T 				   mapped_type;
+	typedef pair<Key, T> 	   value_type;
+	typedef Compare 		   key_compare;
+
+	class value_compare : public binary_functor<value_type, value_type, bool>
+	{
+	friend class flat_map<Key, T, Compare, Alloc>;
+	protected:
+		Compare comp;
+		value_compare(Compare c) : comp(c){}
+	public:
+		bool operator()(const value_type& x, const value_type& y) const
+		{return comp(x.first, y.first);}
+	};
+
+private:
+	typedef flat_tree<key_type, value_type, select1st<value_type>,
+					  key_compare, Alloc> tree_type;
+	tree_type t;
+
+public:
+	typedef typename tree_type::pointer             pointer;
+	typedef typename tree_type::const_pointer 	    const_pointer;
+	typedef typename tree_type::reference           reference;
+	typedef typename tree_type::const_reference     const_reference;
+	typedef typename tree_type::iterator            iterator;
+	typedef typename tree_type::const_iterator      const_iterator;
+	typedef typename tree_type::reverse_iterator    reverse_iterator;
+	typedef typename tree_type::const_reverse_iterator    const_reverse_iterator;
+	typedef typename tree_type::size_type 		     size_type;
+	typedef typename tree_type::difference_type      difference_type;
+
+	flat_map() : t(Compare()) {}
+	explicit flat_map(const Compare& comp) : t(comp){}
+
+	template <class InputIterator>
+	flat_map(InputIterator first, InputIterator last)
+		: t(Compare()) {t.insert_unique(first, last);}
+	template <class InputIterator>
+	flat_map(InputIterator first, InputIterator last, const Compare& comp)
+		: t(comp) {t.insert_unique(first, last);}
+
+	flat_map(const flat_map<Key, T, Compare, Alloc>& x) : t(x.t) {}
+
+	flat_map<Key, T, Compare, Alloc>&
+	operator=(const flat_map<Key, T, Compare, Alloc>& x)
+	{
+		t = x.t;
+		return *this;
+	}
+
+	key_compare key_comp() const {return t.key_comp();}
+	value_compare value_comp() const {return value_compare(t.key_comp());}
+	iterator begin() {return t.begin();}
+	const_iterator begin() const {return t.begin();}
+	iterator end() {return t.end();}
+	const_iterator end() const {return t.end();}
+	reverse_iterator rbegin() {return t.rbegin();}
+	const_reverse_iterator rbegin() const {return t.rbegin();}
+	reverse_iterator rend() {return t.rend();}
+	const_reverse_iterator rend() const {return t.rend();}
+	bool empty() const {return t.empty();}
+	size_type size() const {return t.size();}
+	size_type max_size() const {return t.max_size();}
+	size_type capacity() const {return t.capacity();}
+	void reserve(size_type n) {t.reserve(n);}
+
+	// Subscript operator
+	// Return by reference so that it could be lvalue or rvalue
+	T& operator[] (const key_type& k)
+	{
+		return (*((insert(value_type(k, T()))).first)).second;
+	}
+
+	void swap(flat_map<Key, T, Compare, Alloc>& x) {t.swap(x.t);}
+
+	pair<iterator, bool> insert(const value_type& x)
+	{
+		return t.insert_unique(x);
+	}
+
+	// O(1) search if x goes right before position
+	iterator insert(const_iterator position, const value_type& x)
+	{
+		return t.insert_unique(position, x);
+	}
+
+	// Batch insert: append, sort, merge
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		t.insert_unique(first, last);
+	}
+
+	// Iterator to the element after pos
+	iterator erase(const_iterator pos) {return t.erase(pos);}
+	size_type erase(const key_type& x) {return t.erase(x);}
+	iterator erase(const_iterator first, const_iterator last)
+	{return t.erase(first, last);}
+	void clear() {t.clear();}
+
+	iterator find(const key_type& x) {return t.find(x);}
+	const_iterator find(const key_type& x) const {return t.find(x);}
+	// Transparent find, see "my_functors.h"
+	template <class K>
+	typename __if_transparent<K, const_iterator, Compare>::type
+	find(const K& x) const {return t.find(x);}
+	size_type count(const key_type& x) const {return t.count(x);}
+
+	iterator lower_bound(const key_type& x) {return t.lower_bound(x);}
+	const_iterator lower_bound(const key_type& x) const {return t.lower_bound(x);}
+	iterator upper_bound(const key_type& x) {return t.upper_bound(x);}
+	const_iterator upper_bound(const key_type& x) const {return t.upper_bound(x);}
+	pair<iterator, iterator> equal_range(const key_type& x)
+	{return t.equal_range(x);}
+	pair<const_iterator, const_iterator> equal_range(const key_type& x) const
+	{
+		pair<iterator, iterator> p = t.equal_range(x);
+		return pair<const_iterator, const_iterator>(p.first, p.second);
+	}
+
+	friend bool operator==(const flat_map<Key, T, Compare, Alloc>& x,
+						   const flat_map<Key, T, Compare, Alloc>& y)
+	{
+		return x.t == y.t;
+	}
+
+	friend bool operator< (const flat_map<Key, T, Compare, Alloc>& x,
+						   const flat_map<Key, T, Compare, Alloc>& y)
+	{
+		return x.t < y.t;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Set with unique elements ordered by Key, kept in a sorted vector:
+ * same interface as set, the fastest lookups and least memory of the
+ * ordered sets, but O(n) single inserts and erases, see "my_flat_tree.h"
+ * Fill it with the range constructor or range insert.
+ * Inserts and erases invalidate iterators; no node handles
+ */
+
+#ifndef _MY_FLAT_SET_
+#define _MY_FLAT_SET_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_flat_tree.h"
+
+namespace fyj
+{
+
+template <class Key, class Compare = less<Key>, class Alloc = alloc>
+class flat_set
+{
+public:
+	typedef Key 	key_type;
+	typedef Key 	value_type;
+	typedef Compare key_compare;
+	typedef Compare value_compare;
+
+private:
+	typedef flat_tree<key_type, value_type, identity<value_type>,
+					  key_compare, Alloc> tree_type;
+	tree_type t;
+
+public:
+	// The key is not allowed to be modified in a set, so "const"
+	typedef typename tree_type::const_pointer     pointer;
+	typedef typename tree_type::const_pointer 	  const_pointer;
+	typedef typename tree_type::const_reference   reference;
+	typedef typename tree_type::const_reference   const_reference;
+	typedef typename tree_type::const_iterator    iterator;
+	typedef typename tree_type::const_iterator    const_iterator;
+	typedef typename tree_type::const_reverse_iterator    reverse_iterator;
+	typedef typename tree_type::const_reverse_iterator    const_reverse_iterator;
+	typedef typename tree_type::size_type 		   size_type;
+	typedef typename tree_type::difference_type    difference_type;
+
+	flat_set() : t(Compare()) {}
+	explicit flat_set(const Compare& comp) : t(comp){}
+
+	template <class InputIterator>
+	flat_set(InputIterator first, InputIterator last)
+		: t(Compare()) {t.insert_unique(first, last);}
+	template <class InputIterator>
+	flat_set(InputIterator first, InputIterator last, const Compare& comp)
+		: t(comp) {t.insert_unique(first, last);}
+
+	flat_set(const flat_set<Key, Compare, Alloc>& x) : t(x.t) {}
+
+	flat_set<Key, Compare, Alloc>&
+	operator=(const flat_set<Key, Compare, Alloc>& x)
+	{
+		t = x.t;
+		return *this;
+	}
+
+	key_compare key_comp() const {return t.key_comp();}
+	value_compare value_comp() const {return t.key_comp();}
+	iterator begin() const {return t.begin();}
+	iterator end() const {return t.end();}
+	reverse_iterator rbegin() const {return t.rbegin();}
+	reverse_iterator rend() const {return t.rend();}
+	bool empty() const {return t.empty();}
+	size_type size() const {return t.size();}
+	size_type max_size() const {return t.max_size();}
+	size_type capacity() const {return t.capacity();}
+	void reserve(size_type n) {t.reserve(n);}
+	void swap(flat_set<Key, Compare, Alloc>& x) {t.swap(x.t);}
+
+	pair<iterator, bool> insert(const value_type& x)
+	{
+		pair<typename tree_type::iterator, bool> p = t.insert_unique(x);
+		return pair<iterator, bool>(p.first, p.second);
+	}
+
+	// O(1) search if x goes right before position
+	iterator insert(iterator position, const value_type& x)
+	{
+		return t.insert_unique(position, x);
+	}
+
+	// Batch insert: append, sort, merge
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		t.insert_unique(first, last);
+	}
+
+	// Iterator to the element after pos
+	iterator erase(iterator pos) {return t.erase(pos);}
+	size_type erase(const key_type& x) {return t.erase(x);}
+	iterator erase(iterator first, iterator last) {return t.erase(first, last);}
+	void clear() {t.clear();}
+
+	iterator find(const key_type& x) const {return t.find(x);}
+	// Transparent find, see "my_functors.h"
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	find(const K& x) const {return t.find(x);}
+	size_type count(const key_type& x) const {return t.count(x);}
+
+	iterator lower_bound(const key_type& x) const {return t.lower_bound(x);}
+	iterator upper_bound(const key_type& x) const {return t.upper_bound(x);}
+	pair<iterator, iterator> equal_range(const key_type& x) const
+	{
+		pair<typename tree_type::iterator, typename tree_type::iterator> p =
+			t.equal_range(x);
+		return pair<iterator, iterator>(p.first, p.second);
+	}
+
+	friend bool operator==(const flat_set<Key, Compare, Alloc>& x,
+						   const flat_set<Key, Compare, Alloc>& y)
+	{
+		return x.t == y.t;
+	}
+
+	friend bool operator< (const flat_set<Key, Compare, Alloc>& x,
+						   const flat_set<Key, Compare, Alloc>& y)
+	{
+		return x.t < y.t;
+	}
+};
+
+}
+
+#endif
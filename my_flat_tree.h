@@ -0,0 +1,292 @@
+/* Flat tree: the sorted array behind the flat ordered containers
+ * (flat_map / flat_set / flat_multimap / flat_multiset)
+ *
+ * The values sit in one fyj::vector, in key order. Compared with
+ * rb_tree:
+ *     # a lookup is a binary search (lower_bound / upper_bound of
+ *       "my_algo.h") over contiguous memory, and iteration is a scan
+ *     # no per-value node: memory per element is sizeof(Value)
+ *     # but a single insert or erase shifts the values after it: O(n)
+ * So they suit tables built once, or in batches, and then mostly read.
+ * The range insert is the way to fill them: the batch is appended,
+ * stable sorted and merged in, O(n + m log m) for m values.
+ *
+ * Values are assigned when they move, so the value_type of flat_map is
+ * pair<Key, T>, not pair<const Key, T>: do not change a key in place.
+ * Inserts and erases invalidate iterators; no node handles.
+ */
+
+#ifndef _MY_FLAT_TREE_
+#define _MY_FLAT_TREE_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_vector.h"
+
+namespace fyj
+{
+
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc = alloc>
+class flat_tree
+{
+public:
+	typedef Key                   key_type;
+	typedef Value                 value_type;
+	typedef value_type* 		  pointer;
+	typedef const value_type* 	  const_pointer;
+	typedef value_type& 	      reference;
+	typedef const value_type&     const_reference;
+	typedef value_type*           iterator;
+	typedef const value_type*     const_iterator;
+	typedef fyj::reverse_iterator<iterator> reverse_iterator;
+	typedef fyj::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef size_t                size_type;
+	typedef ptrdiff_t             difference_type;
+
+protected:
+	// Comparators for the searches of "my_algo.h": lower_bound calls
+	// comp(value, key), upper_bound comp(key, value)
+	struct value_key_less
+	{
+		Compare comp;
+		value_key_less(const Compare& c) : comp(c) {}
+		template <class K>
+		bool operator()(const Value& x, const K& k) const
+		{return comp(KeyOfValue()(x), k);}
+	};
+
+	struct key_value_less
+	{
+		Compare comp;
+		key_value_less(const Compare& c) : comp(c) {}
+		template <class K>
+		bool operator()(const K& k, const Value& x) const
+		{return comp(k, KeyOfValue()(x));}
+	};
+
+	struct value_less
+	{
+		Compare comp;
+		value_less(const Compare& c) : comp(c) {}
+		bool operator()(const Value& x, const Value& y) const
+		{return comp(KeyOfValue()(x), KeyOfValue()(y));}
+	};
+
+	vector<Value, Alloc> v;
+	Compare key_compare;
+
+	static const Key& key(const Value& x) {return KeyOfValue()(x);}
+
+	iterator to_iterator(const_iterator it) const
+	{
+		return v.begin() + (it - v.begin());
+	}
+
+public:
+	flat_tree(const Compare& comp = Compare()) : v(), key_compare(comp) {}
+
+	Compare key_comp() const {return key_compare;}
+	iterator begin() const {return v.begin();}
+	iterator end() const {return v.end();}
+	reverse_iterator rbegin() const {return reverse_iterator(end());}
+	reverse_iterator rend() const {return reverse_iterator(begin());}
+	bool empty() const {return v.begin() == v.end();}
+	size_type size() const {return v.size();}
+	size_type max_size() const {return size_type(-1) / sizeof(Value);}
+	size_type capacity() const {return v.capacity();}
+	void reserve(size_type n) {v.reserve(n);}
+
+	void swap(flat_tree<Key, Value, KeyOfValue, Compare, Alloc>& x)
+	{
+		v.swap(x.v);
+		fyj::swap(key_compare, x.key_compare);
+	}
+
+	//================ FIND ====================================
+	// K is Key, or any type Compare can order against Key when it is
+	// transparent (see the containers)
+	template <class K>
+	iterator lower_bound(const K& k) const
+	{
+		return fyj::lower_bound(begin(), end(), k,
+								value_key_less(key_compare));
+	}
+
+	template <class K>
+	iterator upper_bound(const K& k) const
+	{
+		return fyj::upper_bound(begin(), end(), k,
+								key_value_less(key_compare));
+	}
+
+	// The upper bound is searched after the lower one only
+	template <class K>
+	pair<iterator, iterator> equal_range(const K& k) const
+	{
+		iterator first = lower_bound(k);
+		return pair<iterator, iterator>(first,
+			fyj::upper_bound(first, end(), k, key_value_less(key_compare)));
+	}
+
+	template <class K>
+	iterator find(const K& k) const
+	{
+		iterator it = lower_bound(k);
+		return (it == end() || key_compare(k, key(*it))) ? end() : it;
+	}
+
+	// Two binary searches, however many values are equal
+	template <class K>
+	size_type count(const K& k) const
+	{
+		pair<iterator, iterator> p = equal_range(k);
+		return size_type(p.second - p.first);
+	}
+
+	//================ INSERT ==================================
+	pair<iterator, bool> insert_unique(const value_type& x)
+	{
+		iterator it = lower_bound(key(x));
+		if(it != end() && !key_compare(key(x), key(*it)))
+			return pair<iterator, bool>(it, false);
+		return pair<iterator, bool>(v.insert(it, x), true);
+	}
+
+	// After the equal values
+	iterator insert_equal(const value_type& x)
+	{
+		return v.insert(upper_bound(key(x)), x);
+	}
+
+	// x goes right before position if that keeps the order: no search
+	iterator insert_unique(const_iterator position, const value_type& x)
+	{
+		if((position == begin() || key_compare(key(position[-1]), key(x))) &&
+		   (position == end() || key_compare(key(x), key(*position))))
+			return v.insert(to_iterator(position), x);
+		return insert_unique(x).first;
+	}
+
+	iterator insert_equal(const_iterator position, const value_type& x)
+	{
+		if((position == begin() || !key_compare(key(x), key(position[-1]))) &&
+		   (position == end() || !key_compare(key(*position), key(x))))
+			return v.insert(to_iterator(position), x);
+		return insert_equal(x);
+	}
+
+	// Batch insert, see __merge_tail
+	// Of equal keys, the first one in is kept
+	template <class InputIterator>
+	void insert_unique(InputIterator first, InputIterator last)
+	{
+		size_type n = size();
+		for(; first != last; ++first)
+			v.push_back(*first);
+		__merge_tail(n, true);
+	}
+
+	// Equal keys keep their order: old values first, then the batch's
+	template <class InputIterator>
+	void insert_equal(InputIterator first, InputIterator last)
+	{
+		size_type n = size();
+		for(; first != last; ++first)
+			v.push_back(*first);
+		__merge_tail(n, false);
+	}
+
+	//================ ERASE ===================================
+	// Returns the iterator after pos
+	iterator erase(const_iterator pos) {return v.erase(to_iterator(pos));}
+
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		return v.erase(to_iterator(first), to_iterator(last));
+	}
+
+	// Erase all the values with key k, return how many
+	size_type erase(const Key& k)
+	{
+		pair<iterator, iterator> p = equal_range(k);
+		size_type n = size_type(p.second - p.first);
+		v.erase(p.first, p.second);
+		return n;
+	}
+
+	void clear() {v.clear();}
+
+protected:
+	// The values from n on were just appended: stable sort them, drop
+	// the repeated keys if unique, then merge them with the first n.
+	// A batch that goes after all the old values (e.g. the sorted bulk
+	// load of an empty table) needs no merge.
+	void __merge_tail(size_type n, bool unique)
+	{
+		iterator mid = v.begin() + n;
+		if(mid == v.end())
+			return;
+		value_less comp(key_compare);
+		{
+			vector<Value, Alloc> buffer(size_type(v.end() - mid), *mid);
+			stable_sort(mid, v.end(), buffer.begin(), comp);
+		}
+		if(unique)
+		{
+			iterator last = mid;
+			for(iterator i = mid + 1; i != v.end(); ++i)
+				if(comp(*last, *i))
+					*++last = *i;
+			v.erase(last + 1, v.end());
+		}
+		if(mid == v.begin() ||
+		   (unique ? comp(mid[-1], *mid) : !comp(*mid, mid[-1])))
+			return;
+
+		vector<Value, Alloc> result;
+		result.reserve(v.size());
+		iterator first1 = v.begin();
+		iterator first2 = mid;
+		iterator last2 = v.end();
+		while(first1 != mid && first2 != last2)
+		{
+			if(comp(*first2, *first1))
+				result.push_back(*first2++);
+			else if(unique && !comp(*first1, *first2))
+				++first2;	// already in
+			else
+				result.push_back(*first1++);
+		}
+		for(; first1 != mid; ++first1)
+			result.push_back(*first1);
+		for(; first2 != last2; ++first2)
+			result.push_back(*first2);
+		v.swap(result);
+	}
+};
+
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc>
+inline bool operator==(const flat_tree<Key, Value, KeyOfValue, Compare, Alloc>& x,
+					   const flat_tree<Key, Value, KeyOfValue, Compare, Alloc>& y)
+{
+	return x.size() == y.size() && fyj::equal(x.begin(), x.end(), y.begin());
+}
+
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc>
+inline bool operator<(const flat_tree<Key, Value, KeyOfValue, Compare, Alloc>& x,
+					  const flat_tree<Key, Value, KeyOfValue, Compare, Alloc>& y)
+{
+	return fyj::lexicographical_compare(x.begin(), x.end(),
+										y.begin(), y.end());
+}
+
+} // end of namespace
+
+#endif
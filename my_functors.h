@@ -28,7 +28,7 @@ struct binary_functor
 template <class T>
 struct greater : public binary_functor<T, T, bool>
 {
-	bool operator()(const T& x, const T& y)
+	bool operator()(const T& x, const T& y) const
 	{
 		return x > y;
 	}
@@ -37,7 +37,7 @@ struct greater : public binary_functor<T, T, bool>
 template <class T>
 struct less : public binary_functor<T, T, bool>
 {
-	bool operator()(const T& x, const T& y)
+	bool operator()(const T& x, const T& y) const
 	{
 		return x < y;
 	}
@@ -46,7 +46,7 @@ struct less : public binary_functor<T, T, bool>
 template <class T>
 struct greater_equal : public binary_functor<T, T, bool>
 {
-	bool operator()(const T& x, const T& y)
+	bool operator()(const T& x, const T& y) const
 	{
 		return x >= y;
 	}
@@ -55,12 +55,79 @@ struct greater_equal : public binary_functor<T, T, bool>
 template <class T>
 struct less_equal : public binary_functor<T, T, bool>
 {
-	bool operator()(const T& x, const T& y)
+	bool operator()(const T& x, const T& y) const
 	{
 		return x <= y;
 	}
 };
 
+template <class T>
+struct equal_to : public binary_functor<T, T, bool>
+{
+	bool operator()(const T& x, const T& y) const
+	{
+		return x == y;
+	}
+};
+
+
+//======================== TRANSPARENT FUNCTORS ============================
+// A functor is transparent if it has a nested type "is_transparent"
+// Containers then accept any key-compatible type in find / count / 
+// equal_range (e.g. a const char* for string keys), so no temporary
+// Key is built for a lookup
+// For hash containers, both HashFun and EqualKey must be transparent,
+// and HashFun must give the same hash to a key and to its look-alikes
+template <class T>
+struct __void_type {typedef void type;};
+
+template <class F, class Enable = void>
+struct __is_transparent {static const bool value = false;};
+
+template <class F>
+struct __is_transparent<F, 
+			typename __void_type<typename F::is_transparent>::type>
+{
+	static const bool value = true;
+};
+
+template <bool Cond, class T = void>
+struct __enable_if {};
+
+template <class T>
+struct __enable_if<true, T> {typedef T type;};
+
+// Return type R of a lookup by a K, only if F1 and F2 are transparent
+// K takes part so that the check happens per call (SFINAE), not when
+// the container class is instantiated
+template <class K, class R, class F1, class F2 = F1>
+struct __if_transparent
+	: public __enable_if<__is_transparent<F1>::value &&
+						 __is_transparent<F2>::value, R> {};
+
+// less<void> / equal_to<void> compare any two comparable types
+template <>
+struct less<void>
+{
+	typedef void is_transparent;
+	template <class T1, class T2>
+	bool operator()(const T1& x, const T2& y) const
+	{
+		return x < y;
+	}
+};
+
+template <>
+struct equal_to<void>
+{
+	typedef void is_transparent;
+	template <class T1, class T2>
+	bool operator()(const T1& x, const T2& y) const
+	{
+		return x == y;
+	}
+};
+
 
 //====================== IDENTITY ========================================
 // Return the same value as passed into function
@@ -5,6 +5,7 @@
  * When looking for an element:
  *     # first look which bucket number (bkt_num) it store
  *     # then look the position of the list of the bucket
+ * A bitmap of the non-empty buckets lets iteration skip the empty ones
  */
 
 #ifndef _MY_HASH_TABLE_
@@ -19,6 +20,7 @@
 #include "my_functors.h"
 #include "my_vector.h"
 #include "my_pair.h"
+#include "my_node_handle.h"
 
 namespace fyj
 {
@@ -30,31 +32,39 @@ struct __hashtable_node
 	Value val;
 };
 
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class EqualKey, class Alloc = alloc>
+class hashtable;
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class EqualKey, class Alloc>
+struct __hashtable_const_iterator;
+
 template <class Value, class Key, class HashFun,
   		  class ExtractKey, class EqualKey, class Alloc>
 struct __hashtable_iterator
 {
 	typedef hashtable<Value, Key, HashFun, 
-					  ExtractKey, EqualKey, Alloc> hashtable;
+					  ExtractKey, EqualKey, Alloc> hashtable_type;
     typedef __hashtable_iterator<Value, Key, HashFun, ExtractKey,
     					EqualKey, Alloc> iterator;
     typedef __hashtable_const_iterator<Value, Key, HashFun, ExtractKey,
     					EqualKey, Alloc> const_iterator;   	
     typedef __hashtable_node<Value> node;
 
-    typedef forward_iterator_list iterator_category;
+    typedef forward_iterator_tag iterator_category;
     typedef Value value_type;
     typedef ptrdiff_t difference_type;
     typedef size_t size_type;
     typedef Value& reference;
     typedef Value* pointer;
 
-    node* curr;
-    hashtable* ht;
+    node* cur;
+    hashtable_type* ht;
 
     __hashtable_iterator(){}
-    __hashtable_iterator(node* n, hashtable* tab)
-    	: node(n), ht(tab) {}
+    __hashtable_iterator(node* n, hashtable_type* tab)
+    	: cur(n), ht(tab) {}
 
     reference operator*() const {return cur->val;}
     pointer operator->() const {return &(operator*());}
@@ -64,11 +74,7 @@ struct __hashtable_iterator
     	const node* old = cur;
     	cur = cur->next;
     	if(!cur)
-    	{
-    		size_type bucket = ht->bkt_num(old->val);
-    		while(!cur && ++bucket < ht->buckets.size())
-    			cur = ht->buckets[bucket];
-    	}
+    		cur = ht->next_bucket_head(old);
     	return *this;
     }    								
 
@@ -87,7 +93,64 @@ struct __hashtable_iterator
     {
     	return it.cur != cur;
     }
-};  
+};
+
+template <class Value, class Key, class HashFun,
+  		  class ExtractKey, class EqualKey, class Alloc>
+struct __hashtable_const_iterator
+{
+	typedef hashtable<Value, Key, HashFun,
+					  ExtractKey, EqualKey, Alloc> hashtable_type;
+    typedef __hashtable_iterator<Value, Key, HashFun, ExtractKey,
+    					EqualKey, Alloc> iterator;
+    typedef __hashtable_const_iterator<Value, Key, HashFun, ExtractKey,
+    					EqualKey, Alloc> const_iterator;
+    typedef __hashtable_node<Value> node;
+
+    typedef forward_iterator_tag iterator_category;
+    typedef Value value_type;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef const Value& reference;
+    typedef const Value* pointer;
+
+    const node* cur;
+    const hashtable_type* ht;
+
+    __hashtable_const_iterator(){}
+    __hashtable_const_iterator(const node* n, const hashtable_type* tab)
+    	: cur(n), ht(tab) {}
+    __hashtable_const_iterator(const iterator& it)
+    	: cur(it.cur), ht(it.ht) {}
+
+    reference operator*() const {return cur->val;}
+    pointer operator->() const {return &(operator*());}
+
+    const_iterator& operator++()
+    {
+    	const node* old = cur;
+    	cur = cur->next;
+    	if(!cur)
+    		cur = ht->next_bucket_head(old);
+    	return *this;
+    }
+
+    const_iterator operator++(int)
+    {
+    	const_iterator temp = *this;
+    	++*this; // operator++()
+    	return temp;
+    }
+
+    bool operator==(const const_iterator& it) const
+    {
+    	return it.cur == cur;
+    }
+    bool operator!=(const const_iterator& it) const
+    {
+    	return it.cur != cur;
+    }
+};
 
 static const int __num_primes = 28;
 
@@ -102,21 +165,171 @@ static const unsigned long __prime_list[__num_primes] =
   1610612741ul, 3221225473ul, 4294967291ul
 };
 
-unsigned long __next_prime(unsigned long n)
+inline unsigned long __next_prime(unsigned long n)
 {
 	const unsigned long* first = __prime_list;
 	const unsigned long* last = first + __num_primes;
 	const unsigned long* pos = lower_bound(first, last, n);
-	return pos == last ? *(last - 1) : pos;
+	return pos == last ? *(last - 1) : *pos;
 }
 
+// Incremental rehash: buckets drained per insert while a rehash is running.
+// Each step drains at most __rehash_step non-empty buckets of the old table
+// (empty ones are jumped over with the occupancy bitmap), so every
+// operation pays a small bounded cost instead of one huge stall.
+// Two buckets per insert ensure the old table is drained long before
+// the next growth (the table doubles, so at least old_n inserts remain)
+static const int __rehash_step = 2;
+
+// Bulk insert / batched find: number of keys hashed (and bucket slots
+// prefetched) before the first of them is resolved
+static const int __bulk_batch = 16;
+
+#if defined(__GNUC__)
+#	define __HT_PREFETCH(p) __builtin_prefetch(p)
+#else
+#	define __HT_PREFETCH(p)
+#endif
+
+// One bit per bucket, set iff the chain of the bucket is not empty.
+// Iteration looks for the next non-empty bucket a word (32 or 64
+// buckets) at a time, so a scan of a sparse table does not read
+// every bucket head.
+// A second level (one bit per non-zero word) jumps over whole empty
+// regions, e.g. after a mass erase or in a large reserved table:
+// 64 * 64 buckets per word read
+template <class Alloc>
+class __bucket_bitmap
+{
+	typedef unsigned long word;
+	enum {word_bits = sizeof(word) * 8};
+
+	vector<word, Alloc> words;
+	vector<word, Alloc> summary;	// bit w: words[w] != 0
+	size_t nbits;
+
+	static size_t first_bit(word w)
+	{
+#if defined(__GNUC__)
+		return __builtin_ctzl(w);
+#else
+		size_t j = 0;
+		while(!(w & 1))
+			w >>= 1, ++j;
+		return j;
+#endif
+	}
+
+	static size_t bit_count(word w)
+	{
+#if defined(__GNUC__)
+		return __builtin_popcountl(w);
+#else
+		size_t n = 0;
+		for(; w; w &= w - 1)
+			++n;
+		return n;
+#endif
+	}
+
+	static size_t words_for(size_t n) {return (n + word_bits - 1) / word_bits;}
+
+	// First non-zero word at or after w; words.size() if none
+	size_t next_word(size_t w) const
+	{
+		size_t s = w / word_bits;
+		if(s >= summary.size())
+			return words.size();
+		word bits = summary.begin()[s] & (~word(0) << (w % word_bits));
+		while(!bits)
+		{
+			if(++s == summary.size())
+				return words.size();
+			bits = summary.begin()[s];
+		}
+		return s * word_bits + first_bit(bits);
+	}
+
+public:
+	__bucket_bitmap() : nbits(0) {}
+
+	// n bits, all clear
+	void reset(size_t n)
+	{
+		vector<word, Alloc> temp(words_for(n), word(0));
+		words.swap(temp);
+		vector<word, Alloc> temp_summary(words_for(words.size()), word(0));
+		summary.swap(temp_summary);
+		nbits = n;
+	}
+
+	// All bits clear: only the non-zero words are written
+	void clear()
+	{
+		for(size_t w = next_word(0); w < words.size(); w = next_word(w + 1))
+			words[w] = 0;
+		for(size_t s = 0; s < summary.size(); ++s)
+			summary[s] = 0;
+	}
+
+	size_t size() const {return nbits;}
+
+	void set(size_t i)
+	{
+		const size_t w = i / word_bits;
+		words[w] |= word(1) << (i % word_bits);
+		summary[w / word_bits] |= word(1) << (w % word_bits);
+	}
+
+	void unset(size_t i)
+	{
+		const size_t w = i / word_bits;
+		words[w] &= ~(word(1) << (i % word_bits));
+		if(!words[w])
+			summary[w / word_bits] &= ~(word(1) << (w % word_bits));
+	}
+
+	// First set bit at or after i; size() if none
+	size_t next(size_t i) const
+	{
+		if(i >= nbits)
+			return nbits;
+		size_t w = i / word_bits;
+		word bits = words.begin()[w] & (~word(0) << (i % word_bits));
+		if(!bits)
+		{
+			w = next_word(w + 1);
+			if(w == words.size())
+				return nbits;
+			bits = words.begin()[w];
+		}
+		return w * word_bits + first_bit(bits);
+	}
+
+	// Number of set bits
+	size_t count() const
+	{
+		size_t n = 0;
+		for(size_t w = next_word(0); w < words.size(); w = next_word(w + 1))
+			n += bit_count(words.begin()[w]);
+		return n;
+	}
+
+	void swap(__bucket_bitmap& x)
+	{
+		words.swap(x.words);
+		summary.swap(x.summary);
+		fyj::swap(nbits, x.nbits);
+	}
+};
+
 // @Value: used for map; for set, value = key
 // @Key: used for map and set
 // @HashFun: input_value -> hash_value defined in "my_functors.h"
 // @ExtractKey: extract the key of a given value
 // @EqualKey: see if two keys are equal
 template <class Value, class Key, class HashFun, class ExtractKey,
-		  class EqualKey, class Alloc = alloc>
+		  class EqualKey, class Alloc>
 class hashtable
 {
 public:
@@ -125,6 +338,22 @@ public:
 	typedef HashFun hasher;
 	typedef EqualKey key_equal;
 	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	typedef value_type* pointer;
+	typedef const value_type* const_pointer;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+
+	typedef __hashtable_iterator<Value, Key, HashFun, ExtractKey,
+								 EqualKey, Alloc> iterator;
+	typedef __hashtable_const_iterator<Value, Key, HashFun, ExtractKey,
+									   EqualKey, Alloc> const_iterator;
+	typedef __node_handle<__hashtable_node<Value>, Value,
+						  &__hashtable_node<Value>::val, Alloc> node_type;
+	friend struct __hashtable_iterator<Value, Key, HashFun, ExtractKey,
+									   EqualKey, Alloc>;
+	friend struct __hashtable_const_iterator<Value, Key, HashFun, ExtractKey,
+											 EqualKey, Alloc>;
 
 private:
 	hasher hash;
@@ -137,26 +366,65 @@ private:
 	vector<node*, Alloc> buckets;
 	size_type num_elements;
 
+	// Load factor = num_elements / buckets.size()
+	// The table grows once an insert would push it above max_load;
+	// grow_threshold caches buckets.size() * max_load for the insert path
+	float max_load;
+	size_type grow_threshold;
+
+	// Incremental rehash state
+	// While old_buckets is not empty, a rehash is in progress:
+	//     # old_buckets[0, rehash_idx) are already drained into buckets
+	//     # old_buckets[rehash_idx, old_n) still hold their nodes
+	// So a key lives in old_buckets iff its old bucket >= rehash_idx
+	vector<node*, Alloc> old_buckets;
+	size_type rehash_idx;
+	bool incremental;
+
+	// Non-empty buckets of buckets / old_buckets
+	__bucket_bitmap<Alloc> occupied;
+	__bucket_bitmap<Alloc> old_occupied;
+
 	node* new_node(const value_type& obj)
 	{
 		node* n = node_allocator::allocate();
 		n->next = 0;
-		construct(&n->val, obj);
+		try {
+			construct(&n->val, obj);
+		}
+		catch(...){
+			node_allocator::deallocate(n);
+			throw;
+		}
 		return n;
 	}
 
 	void delete_node(node* n)
 	{
 		destroy(&n->val);
-		node_allocator::deallocate();
+		node_allocator::deallocate(n);
 	}
 
 	size_type next_size(size_type n) const
-	{return __next_prime; }
+	{return __next_prime(n); }
+
+	// Min number of buckets to hold n elements under max_load
+	size_type buckets_for(size_type n) const
+	{
+		const double need = double(n) / max_load;
+		size_type n_buckets = size_type(need);
+		return n_buckets < need ? n_buckets + 1 : n_buckets;
+	}
+
+	void update_threshold()
+	{
+		grow_threshold = size_type(double(buckets.size()) * max_load);
+	}
 
 	//================= BKT_NUM ===============================
-	// v0
-	size_type bkt_num_key(const key_type& key, size_t n) const
+	// v0: key may be any type the hasher accepts (transparent lookup)
+	template <class K>
+	size_type bkt_num_key(const K& key, size_t n) const
 	{
 		return hash(key) % n; // hash defined in "my_functors.h"
 	}
@@ -176,7 +444,309 @@ private:
 		return bkt_num_key(key, buckets.size()); //v0
 	}
 
+	//================= INCREMENTAL REHASH =====================
+	bool rehashing() const {return old_buckets.size() != 0;}
 
+	// Head of the chain where key is (or would be) stored
+	template <class K>
+	node*& bucket_head(const K& key)
+	{
+		if(rehashing())
+		{
+			const size_type n = bkt_num_key(key, old_buckets.size());
+			if(n >= rehash_idx)
+				return old_buckets[n];
+		}
+		return buckets[bkt_num_key(key, buckets.size())];
+	}
+
+	template <class K>
+	node* bucket_head(const K& key) const
+	{
+		if(rehashing())
+		{
+			const size_type n = bkt_num_key(key, old_buckets.size());
+			if(n >= rehash_idx)
+				return old_buckets.begin()[n];
+		}
+		return buckets.begin()[bkt_num_key(key, buckets.size())];
+	}
+
+	// Keep the occupancy bit of the chain head in step with it
+	// head is a slot of buckets or of old_buckets
+	void update_bit(node* const& head)
+	{
+		node* const* p = &head;
+		__bucket_bitmap<Alloc>& bits =
+			p >= buckets.begin() && p < buckets.end() ? occupied
+													  : old_occupied;
+		const size_type i = p - (&bits == &occupied ? buckets.begin()
+													: old_buckets.begin());
+		if(head)
+			bits.set(i);
+		else
+			bits.unset(i);
+	}
+
+	// Move every node of old_buckets[bucket] into buckets
+	void migrate_bucket(size_type bucket)
+	{
+		node* first = old_buckets[bucket];
+		while(first)
+		{
+			size_type new_bucket = bkt_num(first->val);
+			old_buckets[bucket] = first->next;
+			first->next = buckets[new_bucket];
+			buckets[new_bucket] = first;
+			occupied.set(new_bucket);
+			first = old_buckets[bucket];
+		}
+		old_occupied.unset(bucket);
+	}
+
+	// Drop the drained old table and give its memory back
+	void finish_rehash()
+	{
+		vector<node*, Alloc> empty;
+		old_buckets.swap(empty);
+		old_occupied.reset(0);
+		rehash_idx = 0;
+	}
+
+	// One bounded step of incremental rehash
+	void rehash_step()
+	{
+		if(!rehashing())
+			return;
+		const size_type old_n = old_buckets.size();
+		for(int moved = 0; moved < __rehash_step; ++moved)
+		{
+			rehash_idx = old_occupied.next(rehash_idx);
+			if(rehash_idx == old_n)
+				break;
+			migrate_bucket(rehash_idx++);
+		}
+		if(old_occupied.next(rehash_idx) == old_n)
+			finish_rehash();
+	}
+
+	// Drain all that is left in one go
+	void rehash_all()
+	{
+		if(!rehashing())
+			return;
+		for(rehash_idx = old_occupied.next(rehash_idx);
+			rehash_idx < old_buckets.size();
+			rehash_idx = old_occupied.next(rehash_idx + 1))
+			migrate_bucket(rehash_idx);
+		finish_rehash();
+	}
+
+	// First node in a bucket after the one holding old
+	// Undrained old buckets are visited before the new table
+	node* next_bucket_head(const node* old) const
+	{
+		size_type bucket;
+		if(rehashing())
+		{
+			bucket = bkt_num(old->val, old_buckets.size());
+			if(bucket >= rehash_idx)
+			{
+				bucket = old_occupied.next(bucket + 1);
+				if(bucket < old_buckets.size())
+					return old_buckets.begin()[bucket];
+				return first_head(0);
+			}
+		}
+		bucket = bkt_num(old->val);
+		return first_head(bucket + 1);
+	}
+
+	// First non-empty chain of buckets from index n
+	node* first_head(size_type n) const
+	{
+		n = occupied.next(n);
+		if(n == buckets.size())
+			return 0;
+		// Non-empty slots are not next door, so the hardware does not
+		// fetch them ahead: fetch the node of the next one and the
+		// slot of the one after (fetched by the previous call)
+		const size_type n1 = occupied.next(n + 1);
+		if(n1 != buckets.size())
+		{
+			__HT_PREFETCH(buckets.begin()[n1]);
+			__HT_PREFETCH(buckets.begin() + occupied.next(n1 + 1));
+		}
+		return buckets.begin()[n];
+	}
+
+	// First node of the table: undrained old buckets come first
+	node* first_node() const
+	{
+		if(rehashing())
+		{
+			const size_type n = old_occupied.next(rehash_idx);
+			if(n < old_buckets.size())
+				return old_buckets.begin()[n];
+		}
+		return first_head(0);
+	}
+
+	//================= LOOKUP =================================
+	// Equal keys are always adjacent in a chain (see insert_equal)
+	template <class K>
+	node* find_node(const K& key) const
+	{
+		node* first = bucket_head(key);
+		while(first && !equals(get_key(first->val), key))
+			first = first->next;
+		return first;
+	}
+
+	template <class K>
+	size_type count_key(const K& key) const
+	{
+		size_type result = 0;
+		for(const node* cur = find_node(key);
+			cur && equals(get_key(cur->val), key); cur = cur->next)
+			++result;
+		return result;
+	}
+
+	// [first, past) of the nodes with key; both 0 if there is none
+	template <class K>
+	pair<node*, node*> equal_range_nodes(const K& key) const
+	{
+		node* first = find_node(key);
+		if(!first)
+			return pair<node*, node*>(0, 0);
+		node* last = first;
+		while(last->next && equals(get_key(last->next->val), key))
+			last = last->next;
+		node* past = last->next ? last->next : next_bucket_head(last);
+		return pair<node*, node*>(first, past);
+	}
+
+	template <class K>
+	pair<iterator, iterator> equal_range_key(const K& key)
+	{
+		pair<node*, node*> p = equal_range_nodes(key);
+		return pair<iterator, iterator>(iterator(p.first, this),
+										iterator(p.second, this));
+	}
+
+	template <class K>
+	pair<const_iterator, const_iterator> equal_range_key(const K& key) const
+	{
+		pair<node*, node*> p = equal_range_nodes(key);
+		return pair<const_iterator, const_iterator>(
+			const_iterator(p.first, this), const_iterator(p.second, this));
+	}
+
+	//================= INSERT AT A GIVEN CHAIN ================
+	// @n: node to link, e.g. from a node handle (its value is obj)
+	//     if 0, a new node is built from obj
+	pair<iterator, bool> insert_unique_at(node*& first, 
+										  const value_type& obj,
+										  node* n = 0)
+	{
+		for(node* cur = first; cur; cur = cur->next)
+			if(equals(get_key(cur->val), get_key(obj)))
+				return pair<iterator, bool>(iterator(cur, this),
+					    					false);
+		node* temp = n ? n : new_node(obj);
+		temp->next = first;
+		first = temp;
+		update_bit(first);
+		++num_elements;
+		return pair<iterator, bool>(iterator(temp, this), true);
+	}
+
+	iterator insert_equal_at(node*& first, const value_type& obj,
+							 node* n = 0)
+	{
+		node* temp = n ? n : new_node(obj);
+		for(node* cur = first; cur; cur = cur->next)
+			if(equals(get_key(cur->val), get_key(obj)))
+			{
+				temp->next = cur->next;
+				cur->next = temp;
+				++num_elements;
+				return iterator(temp, this);
+			}
+
+		temp->next = first;
+		first = temp;
+		update_bit(first);
+		++num_elements;
+		return iterator(temp, this);
+	}
+
+	// Take n out of its chain (n may be 0); the node is not freed
+	node* unlink_node(node* n)
+	{
+		if(!n)
+			return 0;
+		node*& head = bucket_head(get_key(n->val));
+		node** prev = &head;
+		while(*prev != n)
+			prev = &(*prev)->next;
+		*prev = n->next;
+		n->next = 0;
+		if(!head)
+			update_bit(head);
+		--num_elements;
+		return n;
+	}
+
+	// Free every node of chain head and empty it
+	void clear_chain(node*& head)
+	{
+		node* cur = head;
+		while(cur)
+		{
+			node* next = cur->next;
+			delete_node(cur);
+			cur = next;
+		}
+		head = 0;
+	}
+
+	//================= BULK INSERT ============================
+	// Grow once for all the n coming elements
+	// A running incremental rehash is finished so that every key
+	// maps to buckets[hash % n] during the whole load
+	void bulk_prepare(size_type n)
+	{
+		resize(num_elements + n);
+		rehash_all();
+	}
+
+	// Hash up to __bulk_batch values and prefetch their bucket slots,
+	// then link them in: the cache misses of one batch overlap instead
+	// of being paid one after the other
+	template <class ForwardIterator>
+	ForwardIterator bulk_insert_batch(ForwardIterator first,
+									  ForwardIterator last, bool unique)
+	{
+		const value_type* vals[__bulk_batch];
+		size_type idx[__bulk_batch];
+		int k = 0;
+		for(; first != last && k < __bulk_batch; ++first, ++k)
+		{
+			vals[k] = &*first;
+			idx[k] = bkt_num(*vals[k]);
+			__HT_PREFETCH(buckets.begin() + idx[k]);
+		}
+		for(int i = 0; i < k; ++i)
+		{
+			if(unique)
+				insert_unique_at(buckets[idx[i]], *vals[i]);
+			else
+				insert_equal_at(buckets[idx[i]], *vals[i]);
+		}
+		return first;
+	}
 
 
 public:
@@ -184,18 +754,60 @@ public:
 	void initialize_buckets(size_type n)
 	{
 		const size_type n_buckets = next_size(n);
-		buckets.reserve(n_buckets);
-		buckets.insert(buckets.end(), n_buckets, (node*)0);
+		vector<node*, Alloc> temp(n_buckets, (node*)0);
+		buckets.swap(temp);
+		occupied.reset(n_buckets);
 		num_elements = 0;
+		update_threshold();
 	}
 
 	hashtable(size_type n, const HashFun& hf, const EqualKey& eql)
 		: hash(hf), equals(eql), get_key(ExtractKey()), 
-		  num_elements(0)
+		  num_elements(0), max_load(1.0f), grow_threshold(0),
+		  rehash_idx(0), incremental(false)
 	{
 		initialize_buckets(n);
 	}
 
+	hashtable(const hashtable& ht)
+		: hash(ht.hash), equals(ht.equals), get_key(ht.get_key),
+		  num_elements(0), max_load(ht.max_load), grow_threshold(0),
+		  rehash_idx(0), incremental(ht.incremental)
+	{
+		copy_from(ht);
+	}
+
+	hashtable& operator=(const hashtable& ht)
+	{
+		if(&ht != this)
+		{
+			hashtable temp(ht);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~hashtable() {clear();}
+
+	void swap(hashtable& ht)
+	{
+		fyj::swap(hash, ht.hash);
+		fyj::swap(equals, ht.equals);
+		fyj::swap(get_key, ht.get_key);
+		buckets.swap(ht.buckets);
+		fyj::swap(num_elements, ht.num_elements);
+		fyj::swap(max_load, ht.max_load);
+		fyj::swap(grow_threshold, ht.grow_threshold);
+		old_buckets.swap(ht.old_buckets);
+		fyj::swap(rehash_idx, ht.rehash_idx);
+		fyj::swap(incremental, ht.incremental);
+		occupied.swap(ht.occupied);
+		old_occupied.swap(ht.old_occupied);
+	}
+
+	hasher hash_fun() const {return hash;}
+	key_equal key_eq() const {return equals;}
+
 	//=================== COUNT ================================
 	size_type bucket_count() const {return buckets.size();}
 	size_type max_bucket_count() const 
@@ -204,20 +816,89 @@ public:
 	size_type max_size() const {return 2*max_bucket_count();}
 	bool empty() const {return num_elements == 0;}
 
+	//=================== LOAD FACTOR ==========================
+	float load_factor() const 
+	{return float(num_elements) / float(buckets.size());}
+	float max_load_factor() const {return max_load;}
+	// Buckets whose chain is not empty (old table included during an
+	// incremental rehash); size() / this is the mean chain length
+	size_type nonempty_bucket_count() const
+	{return occupied.count() + old_occupied.count();}
+	// A lower max load factor trades memory for shorter chains
+	// The table grows at once if it is already above the new limit
+	void max_load_factor(float z)
+	{
+		if(z <= 0)
+			return;
+		max_load = z;
+		update_threshold();
+		resize(num_elements);
+	}
 
-	//=================== INSERT_UNIQUE ==========================
+	//=================== ITERATOR ==============================
+	// Empty buckets are skipped through the occupancy bitmap
+	iterator begin() {return iterator(first_node(), this);}
+	iterator end() {return iterator(0, this);}
+	const_iterator begin() const {return const_iterator(first_node(), this);}
+	const_iterator end() const {return const_iterator(0, this);}
+
+	//=================== REHASH MODE ==========================
+	// In incremental mode, growing the table only allocates the new
+	// bucket array; nodes are moved a few buckets at a time by the
+	// following inserts. Iterators are invalidated by any insert.
+	void set_incremental_rehash(bool on)
+	{
+		incremental = on;
+		if(!on)
+			rehash_all();
+	}
+	bool incremental_rehash() const {return incremental;}
+	bool rehash_in_progress() const {return rehashing();}
+
+
+	//=================== REHASH & RESERVE ========================
+	// Grow so that num_elements_hint elements fit under max_load
 	void resize(size_type num_elements_hint)
+	{
+		if(num_elements_hint > grow_threshold)
+			rehash(buckets_for(num_elements_hint));
+	}
+
+	// Room for n elements without any further growth
+	// Used before bulk loads
+	void reserve(size_type n) {resize(n);}
+
+	// At least n_buckets buckets (never fewer than max_load requires)
+	// Buckets never shrink: a smaller n_buckets is a no-op
+	void rehash(size_type n_buckets)
 	{
 		const size_type old_n = buckets.size();
+		const size_type need = buckets_for(num_elements);
+		if(n_buckets < need)
+			n_buckets = need;
 
-		if(num_elements_hint > old_n)
+		if(n_buckets > old_n)
 		{
-			const size_type n = next_size(num_elements_hint);
+			const size_type n = next_size(n_buckets);
 			if(n > old_n)
 			{
+				// a new growth must not stack on a running one
+				rehash_all();
 				vector<node*, Alloc> temp(n, (node*)0);
-				for(size_type bucket = 0; bucket < old_n;
-					++bucket)
+				__bucket_bitmap<Alloc> temp_bits;
+				temp_bits.reset(n);
+				if(incremental)
+				{
+					buckets.swap(temp);
+					old_buckets.swap(temp);
+					occupied.swap(temp_bits);
+					old_occupied.swap(temp_bits);
+					rehash_idx = 0;
+					update_threshold();
+					return;
+				}
+				for(size_type bucket = occupied.next(0); bucket < old_n;
+					bucket = occupied.next(bucket + 1))
 				{
 					node* first = buckets[bucket];
 					while(first)
@@ -226,94 +907,341 @@ public:
 						buckets[bucket] = first->next;
 						first->next = temp[new_bucket];
 						temp[new_bucket] = first;
+						temp_bits.set(new_bucket);
 						first = buckets[bucket];
 					}
 				}
 				buckets.swap(temp);
+				occupied.swap(temp_bits);
+				update_threshold();
 			}
 		}
 	}
 
+	//=================== INSERT_UNIQUE ==========================
 	pair<iterator, bool> insert_unique_noresize(const value_type& obj)
 	{
-		const size_type n = bkt_num(obj);
-		node* first = buckets[n];
-
-		for(node* cur = first; cur; cur = cur->next)
-			if(equals(get_key(cur->val), get_key(obj)))
-				return pair<iterator, bool>(iterator(cur, this),
-					    					false);
-		node* temp = new_node(obj);
-		temp->next = first;
-		buckets[n] = temp;
-		++num_elements;
-		return pair<iterator, bool>(iterator(temp, this), true);
+		return insert_unique_at(bucket_head(get_key(obj)), obj);
 	}
 
 	pair<iterator, bool> insert_unique(const value_type& obj)
 	{
 		resize(num_elements + 1);
+		rehash_step();
 		return insert_unique_noresize(obj);
 	}
 
 	//=================== INSERT_EQUAL =============================
 	iterator insert_equal_noresize(const value_type& obj)
 	{
-		const size_type n = bkt_num(obj);
-		node* first = buckets[n];
+		return insert_equal_at(bucket_head(get_key(obj)), obj);
+	}
 
-		for(node* cur = first; cur; cur = cur->next)
-			if(equals(get_key(cur->val), get_key(obj)))
+	iterator insert_equal(const value_type& obj)
+	{
+		resize(num_elements + 1);
+		rehash_step();
+		return insert_equal_noresize(obj);
+	}
+
+	// The element with the key of obj, inserted first if missing
+	reference find_or_insert(const value_type& obj)
+	{
+		return *insert_unique(obj).first;
+	}
+
+	//=================== FIND & COUNT =============================
+	// Lookups never move nodes (no rehash step), so the const
+	// versions are plain reads
+	iterator find(const key_type& key)
+	{return iterator(find_node(key), this);}
+	const_iterator find(const key_type& key) const
+	{return const_iterator(find_node(key), this);}
+
+	size_type count(const key_type& key) const {return count_key(key);}
+
+	pair<iterator, iterator> equal_range(const key_type& key)
+	{return equal_range_key(key);}
+	pair<const_iterator, const_iterator>
+	equal_range(const key_type& key) const
+	{return equal_range_key(key);}
+
+	// Transparent lookup: only when both HashFun and EqualKey are
+	// transparent (see "my_functors.h"); key is then used as is
+	template <class K>
+	typename __if_transparent<K, iterator, HashFun, EqualKey>::type
+	find(const K& key) 
+	{return iterator(find_node(key), this);}
+
+	template <class K>
+	typename __if_transparent<K, const_iterator, HashFun, EqualKey>::type
+	find(const K& key) const
+	{return const_iterator(find_node(key), this);}
+
+	template <class K>
+	typename __if_transparent<K, size_type, HashFun, EqualKey>::type
+	count(const K& key) const {return count_key(key);}
+
+	template <class K>
+	typename __if_transparent<K, pair<iterator, iterator>,
+							  HashFun, EqualKey>::type
+	equal_range(const K& key) {return equal_range_key(key);}
+
+	template <class K>
+	typename __if_transparent<K, pair<const_iterator, const_iterator>,
+							  HashFun, EqualKey>::type
+	equal_range(const K& key) const {return equal_range_key(key);}
+
+	//=================== ERASE ====================================
+	void erase(const_iterator it)
+	{
+		delete_node(unlink_node(const_cast<node*>(it.cur)));
+	}
+
+	// Number of elements erased
+	// key may be the key of an erased element: the run of equal keys
+	// is unlinked first, then freed
+	size_type erase(const key_type& key)
+	{
+		node*& head = bucket_head(key);
+		node** prev = &head;
+		while(*prev && !equals(get_key((*prev)->val), key))
+			prev = &(*prev)->next;
+		node* first = *prev;
+		if(!first)
+			return 0;
+		// equal keys are adjacent
+		node* past = first->next;
+		while(past && equals(get_key(past->val), key))
+			past = past->next;
+		*prev = past;
+		if(!head)
+			update_bit(head);
+		size_type erased = 0;
+		while(first != past)
+		{
+			node* next = first->next;
+			delete_node(first);
+			first = next;
+			++erased;
+		}
+		num_elements -= erased;
+		return erased;
+	}
+
+	void erase(const_iterator first, const_iterator last)
+	{
+		while(first != last)
+			erase(first++);
+	}
+
+	//=================== FIND_BATCH ===============================
+	// Look up every key of [first, last) and write one iterator per key
+	// (end() if missing) to out. Keys are handled by groups: all the 
+	// bucket slots of a group are prefetched, then all the chain heads,
+	// then the chains are walked. So the cache misses of a group overlap
+	// instead of stalling one lookup after the other.
+	// The keys are taken as key_type, whatever the hash and key_equal
+	template <class ForwardIterator, class OutputIterator>
+	OutputIterator find_batch(ForwardIterator first, ForwardIterator last,
+							  OutputIterator out)
+	{
+		node** slots[__bulk_batch];
+		node* heads[__bulk_batch];
+		while(first != last)
+		{
+			ForwardIterator group = first;
+			int k = 0;
+			for(; first != last && k < __bulk_batch; ++first, ++k)
 			{
-				node* temp = new_node(obj);
-				temp->next = cur->next;
-				cur->next = temp;
-				++num_elements;
-				return iterator(temp, this);
+				const key_type& key = *first;
+				slots[k] = &bucket_head(key);
+				__HT_PREFETCH(slots[k]);
+			}
+			for(int i = 0; i < k; ++i)
+			{
+				heads[i] = *slots[i];
+				__HT_PREFETCH(heads[i]);
 			}
+			for(int i = 0; i < k; ++i, ++group, ++out)
+			{
+				const key_type& key = *group;
+				node* cur = heads[i];
+				while(cur && !equals(get_key(cur->val), key))
+					cur = cur->next;
+				*out = iterator(cur, this);
+			}
+		}
+		return out;
+	}
 
-		node* temp = new_node(obj);
-		temp->next = first;
-		buckets[n] = temp;
-		++num_elements;
-		return iterator(temp, this);
+	//=================== EXTRACT & MERGE ==========================
+	// Take a node out of the table, without freeing it
+	// An empty handle if the key is missing
+	node_type extract(const_iterator it)
+	{return node_type(unlink_node(const_cast<node*>(it.cur)));}
+	node_type extract(const key_type& key) 
+	{return node_type(unlink_node(find_node(key)));}
+
+	// Link the node owned by nh; nh is emptied on success
+	// If the key already exists, nh keeps its node
+	pair<iterator, bool> insert_unique(node_type& nh)
+	{
+		if(nh.empty())
+			return pair<iterator, bool>(end(), false);
+		resize(num_elements + 1);
+		rehash_step();
+		const value_type& obj = nh.value();
+		pair<iterator, bool> p = 
+			insert_unique_at(bucket_head(get_key(obj)), obj, nh.get());
+		if(p.second)
+			nh.release();
+		return p;
 	}
 
-	iterator insert_equal(const value_type& obj)
+	iterator insert_equal(node_type& nh)
 	{
+		if(nh.empty())
+			return end();
 		resize(num_elements + 1);
-		return insert_equal_noresize(obj);
+		rehash_step();
+		const value_type& obj = nh.value();
+		return insert_equal_at(bucket_head(get_key(obj)), obj, 
+							   nh.release());
 	}
 
-	//===================== CLEAR & COPY ============================
-	void clear()
+	// Relink into this table every node of ht whose key is not here
+	// yet; the others stay in ht. Nothing is allocated or copied
+	void merge_unique(hashtable& ht)
+	{
+		if(&ht == this)
+			return;
+		ht.rehash_all();
+		for(size_type i = ht.occupied.next(0); i < ht.buckets.size();
+			i = ht.occupied.next(i + 1))
+		{
+			node** prev = &ht.buckets[i];
+			while(node* n = *prev)
+			{
+				if(find_node(get_key(n->val)))
+				{
+					prev = &n->next;
+					continue;
+				}
+				*prev = n->next;
+				--ht.num_elements;
+				resize(num_elements + 1);
+				rehash_step();
+				insert_equal_at(bucket_head(get_key(n->val)), n->val, n);
+			}
+			ht.update_bit(ht.buckets[i]);
+		}
+	}
+
+	// Relink every node of ht into this table
+	void merge_equal(hashtable& ht)
 	{
-		for(size_type i = 0; i < buckets.size(); ++i)
+		if(&ht == this)
+			return;
+		ht.rehash_all();
+		resize(num_elements + ht.num_elements);
+		for(size_type i = ht.occupied.next(0); i < ht.buckets.size();
+			i = ht.occupied.next(i + 1))
 		{
-			node* cur = buckets[i];
-			while(cur)
+			while(node* n = ht.buckets[i])
 			{
-				node* next = cur->next;
-				delete_node(cur);
-				cur = next;
+				ht.buckets[i] = n->next;
+				--ht.num_elements;
+				rehash_step();
+				insert_equal_at(bucket_head(get_key(n->val)), n->val, n);
 			}
-			buckets[i] = 0;
 		}
+		ht.occupied.clear();
+	}
+
+	//=================== INSERT RANGE =============================
+	template <class InputIterator>
+	void insert_unique(InputIterator first, InputIterator last)
+	{
+		insert_unique(first, last, iterator_category(first));
+	}
+
+	template <class InputIterator>
+	void insert_equal(InputIterator first, InputIterator last)
+	{
+		insert_equal(first, last, iterator_category(first));
+	}
+
+	// Single pass only: no way to know the size in advance
+	template <class InputIterator>
+	void insert_unique(InputIterator first, InputIterator last,
+					   input_iterator_tag)
+	{
+		for(; first != last; ++first)
+			insert_unique(*first);
+	}
+
+	template <class InputIterator>
+	void insert_equal(InputIterator first, InputIterator last,
+					  input_iterator_tag)
+	{
+		for(; first != last; ++first)
+			insert_equal(*first);
+	}
+
+	// Size is known: presize once, then insert in hashed batches
+	template <class ForwardIterator>
+	void insert_unique(ForwardIterator first, ForwardIterator last,
+					   forward_iterator_tag)
+	{
+		bulk_prepare(distance(first, last));
+		while(first != last)
+			first = bulk_insert_batch(first, last, true);
+	}
+
+	template <class ForwardIterator>
+	void insert_equal(ForwardIterator first, ForwardIterator last,
+					  forward_iterator_tag)
+	{
+		bulk_prepare(distance(first, last));
+		while(first != last)
+			first = bulk_insert_batch(first, last, false);
+	}
+
+	//===================== CLEAR & COPY ============================
+	// Undrained old buckets are freed where they are
+	void clear()
+	{
+		for(size_type i = old_occupied.next(rehash_idx); i < old_buckets.size();
+			i = old_occupied.next(i + 1))
+			clear_chain(old_buckets[i]);
+		finish_rehash();
+		for(size_type i = occupied.next(0); i < buckets.size();
+			i = occupied.next(i + 1))
+			clear_chain(buckets[i]);
+		occupied.clear();
 		num_elements = 0;
 	}	
 
+	// A copy never inherits a running rehash: the undrained part of
+	// ht.old_buckets is copied straight into its place in the new table
 	void copy_from(const hashtable& ht)
 	{
-		buckets.clear(); // vector::clear()
-		buckets.reserve(ht.buckets.size());
-		buckets.insert(buckets.end(), ht.buckets.size(),
-					   (node*)0);
-		for(size_type i = 0; i < ht.buckets.size(); ++i)
-		{
-			if(const node* cur = ht.buckets[i])
+		vector<node*, Alloc> temp(ht.buckets.size(), (node*)0);
+		buckets.swap(temp);
+		occupied.reset(buckets.size());
+		finish_rehash();
+		incremental = ht.incremental;
+		max_load = ht.max_load;
+		update_threshold();
+		try {
+			for(size_type i = ht.occupied.next(0); i < ht.buckets.size();
+				i = ht.occupied.next(i + 1))
 			{
+				const node* cur = ht.buckets.begin()[i];
 				node* copy = new_node(cur->val);
 				buckets[i] = copy;
+				occupied.set(i);
 
 				for(node* next = cur->next; next; 
 					cur = next, next = cur->next)
@@ -322,9 +1250,49 @@ public:
 					copy = copy->next;
 				}
 			}
+			for(size_type i = ht.old_occupied.next(ht.rehash_idx);
+				i < ht.old_buckets.size(); i = ht.old_occupied.next(i + 1))
+			{
+				for(const node* cur = ht.old_buckets.begin()[i]; cur; 
+					cur = cur->next)
+				{
+					node* copy = new_node(cur->val);
+					node*& first = buckets[bkt_num(copy->val)];
+					copy->next = first;
+					first = copy;
+					update_bit(first);
+				}
+			}
+		}
+		catch(...){
+			clear();
+			throw;
 		}
 		num_elements = ht.num_elements;
 	}
+
+	// Same elements: for each key, the same values in any order
+	friend bool operator==(const hashtable& a, const hashtable& b)
+	{
+		if(a.num_elements != b.num_elements)
+			return false;
+		for(const_iterator it = a.begin(); it != a.end(); )
+		{
+			// group of it's key in a and in b
+			pair<const_iterator, const_iterator> ra =
+				a.equal_range(a.get_key(*it));
+			pair<const_iterator, const_iterator> rb =
+				b.equal_range(a.get_key(*it));
+			if(distance(ra.first, ra.second) != distance(rb.first, rb.second))
+				return false;
+			for(const_iterator i = ra.first; i != ra.second; ++i)
+				if(fyj::count(ra.first, ra.second, *i) !=
+				   fyj::count(rb.first, rb.second, *i))
+					return false;
+			it = ra.second;
+		}
+		return true;
+	}
 };	  	   
 
 
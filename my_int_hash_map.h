@@ -0,0 +1,104 @@
+#ifndef _MY_INT_HASH_MAP_
+#define _MY_INT_HASH_MAP_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_int_hash_table.h"
+
+namespace fyj
+{
+
+// Map from integers, open addressing, see "my_int_hash_table.h".
+// Elements are pair<Key, T>: the key is not const because slots are
+// moved by assignment, it must not be changed through an iterator
+template <class Key,
+		  class T,
+		  class HashFun = hash<Key>,
+		  class Alloc = alloc>
+class int_hash_map
+{
+
+private:
+	typedef int_hashtable<pair<Key, T>, Key, HashFun,
+						  select1st<pair<Key, T> >, Alloc> ht;
+	ht rep;
+
+public:
+	typedef typename ht::key_type key_type;
+	typedef T data_type;
+	typedef T mapped_type;
+	typedef typename ht::value_type value_type;
+	typedef typename ht::hasher hasher;
+	typedef typename ht::size_type size_type;
+	typedef typename ht::difference_type difference_type;
+	typedef typename ht::pointer pointer;
+	typedef typename ht::const_pointer const_pointer;
+	typedef typename ht::reference reference;
+	typedef typename ht::const_reference const_reference;
+	typedef typename ht::iterator iterator;
+	typedef typename ht::const_iterator const_iterator;
+
+	hasher hash_fun() const {return rep.hash_fun();}
+	key_type empty_key() const {return rep.empty_key_value();}
+
+public:
+	int_hash_map() : rep(0, hasher(), value_type(Key(-1), T())) {}
+	explicit int_hash_map(size_type n)
+		: rep(n, hasher(), value_type(Key(-1), T())) {}
+	int_hash_map(size_type n, const key_type& empty_key)
+		: rep(n, hasher(), value_type(empty_key, T())) {}
+	int_hash_map(size_type n, const key_type& empty_key,
+				 const hasher& hf)
+		: rep(n, hf, value_type(empty_key, T())) {}
+
+	template <class InputIterator>
+	int_hash_map(InputIterator first, InputIterator last)
+		: rep(0, hasher(), value_type(Key(-1), T()))
+		{rep.insert_unique(first, last);}
+
+public:
+	size_type size() const {return rep.size();}
+	size_type max_size() const {return rep.max_size();}
+	bool empty() const {return rep.empty();}
+
+	void swap(int_hash_map& m) {rep.swap(m.rep);}
+
+	iterator begin() {return rep.begin();}
+	iterator end() {return rep.end();}
+	const_iterator begin() const {return rep.begin();}
+	const_iterator end() const {return rep.end();}
+
+public:
+	pair<iterator, bool> insert(const value_type& obj)
+	{return rep.insert_unique(obj);}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{rep.insert_unique(first, last);}
+
+	T& operator[](const key_type& key)
+	{return rep.find_or_insert(value_type(key, T())).second;}
+
+	iterator find(const key_type& key) {return rep.find(key);}
+	const_iterator find(const key_type& key) const {return rep.find(key);}
+	size_type count(const key_type& key) const {return rep.count(key);}
+
+	// Erase moves later elements back: iterators are invalidated
+	size_type erase(const key_type& key) {return rep.erase(key);}
+	void erase(const_iterator it) {rep.erase(it);}
+	void clear() {rep.clear();}
+
+public:
+	void reserve(size_type n) {rep.reserve(n);}
+	size_type bucket_count() const {return rep.bucket_count();}
+
+	float load_factor() const {return rep.load_factor();}
+	float max_load_factor() const {return rep.max_load_factor();}
+	void max_load_factor(float z) {rep.max_load_factor(z);}
+};
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef _MY_INT_HASH_SET_
+#define _MY_INT_HASH_SET_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_functors.h"
+#include "my_int_hash_table.h"
+
+namespace fyj
+{
+
+// Set of integers, open addressing, see "my_int_hash_table.h".
+// empty_key marks free slots: any key may be stored, but the table
+// is filled with copies of it, so pick one that is rare
+template <class Key,
+		  class HashFun = hash<Key>,
+		  class Alloc = alloc>
+class int_hash_set
+{
+
+private:
+	typedef int_hashtable<Key, Key, HashFun, identity<Key>, Alloc> ht;
+	ht rep;
+
+public:
+	typedef typename ht::key_type key_type;
+	typedef typename ht::value_type value_type;
+	typedef typename ht::hasher hasher;
+	typedef typename ht::size_type size_type;
+	typedef typename ht::difference_type difference_type;
+	typedef typename ht::const_pointer pointer;
+	typedef typename ht::const_pointer const_pointer;
+	typedef typename ht::const_reference reference;
+	typedef typename ht::const_reference const_reference;
+	// The key is not allowed to be modified in a set, so "const"
+	typedef typename ht::const_iterator iterator;
+	typedef typename ht::const_iterator const_iterator;
+
+	hasher hash_fun() const {return rep.hash_fun();}
+	key_type empty_key() const {return rep.empty_key_value();}
+
+public:
+	int_hash_set() : rep(0, hasher(), Key(-1)) {}
+	explicit int_hash_set(size_type n) : rep(n, hasher(), Key(-1)) {}
+	int_hash_set(size_type n, const key_type& empty_key)
+		: rep(n, hasher(), empty_key) {}
+	int_hash_set(size_type n, const key_type& empty_key,
+				 const hasher& hf)
+		: rep(n, hf, empty_key) {}
+
+	template <class InputIterator>
+	int_hash_set(InputIterator first, InputIterator last)
+		: rep(0, hasher(), Key(-1))
+		{rep.insert_unique(first, last);}
+
+public:
+	size_type size() const {return rep.size();}
+	size_type max_size() const {return rep.max_size();}
+	bool empty() const {return rep.empty();}
+
+	void swap(int_hash_set& s) {rep.swap(s.rep);}
+
+	iterator begin() const {return rep.begin();}
+	iterator end() const {return rep.end();}
+
+public:
+	pair<iterator, bool> insert(const value_type& obj)
+	{
+		pair<typename ht::iterator, bool> p = rep.insert_unique(obj);
+		return pair<iterator, bool>(p.first, p.second);
+	}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{rep.insert_unique(first, last);}
+
+	iterator find(const key_type& key) const {return rep.find(key);}
+	size_type count(const key_type& key) const {return rep.count(key);}
+
+	// Erase moves later elements back: iterators are invalidated
+	size_type erase(const key_type& key) {return rep.erase(key);}
+	void erase(iterator it) {rep.erase(it);}
+	void clear() {rep.clear();}
+
+public:
+	void reserve(size_type n) {rep.reserve(n);}
+	size_type bucket_count() const {return rep.bucket_count();}
+
+	float load_factor() const {return rep.load_factor();}
+	float max_load_factor() const {return rep.max_load_factor();}
+	void max_load_factor(float z) {rep.max_load_factor(z);}
+};
+
+}
+
+#endif
@@ -0,0 +1,500 @@
+/* Hash table for integer keys, used for int_hash_set / int_hash_map
+ *
+ * Open addressing with linear probing in one flat array of values:
+ * no node, no next pointer, no bucket array. A slot is free when its
+ * key equals a reserved sentinel key (empty_key), so no per-slot
+ * metadata is needed either.
+ *     # memory is capacity * sizeof(Value), and capacity is
+ *       size / max_load_factor (0.8 by default, ~1.25x the raw keys)
+ *       after reserve(); a growth doubles the table
+ *     # capacity need not be a power of two, the hash is reduced to
+ *       the table size by a multiply instead of a mask or a modulo
+ *     # erase shifts the following probe run back (no tombstones)
+ *
+ * The sentinel key itself can still be stored: its element lives in
+ * one extra slot after the table, slots[capacity].
+ *
+ * Keys are compared with ==, Key must be an integral type.
+ */
+
+#ifndef _MY_INT_HASH_TABLE_
+#define _MY_INT_HASH_TABLE_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_construct.h"
+#include "my_uninitialized.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+
+namespace fyj
+{
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class Alloc = alloc>
+class int_hashtable;
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class Alloc>
+struct __int_hashtable_const_iterator;
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class Alloc>
+struct __int_hashtable_iterator
+{
+	typedef int_hashtable<Value, Key, HashFun,
+						  ExtractKey, Alloc> hashtable_type;
+	typedef __int_hashtable_iterator<Value, Key, HashFun,
+									 ExtractKey, Alloc> iterator;
+
+	typedef forward_iterator_tag iterator_category;
+	typedef Value value_type;
+	typedef ptrdiff_t difference_type;
+	typedef size_t size_type;
+	typedef Value& reference;
+	typedef Value* pointer;
+
+	size_type pos;
+	const hashtable_type* ht;
+
+	__int_hashtable_iterator(){}
+	__int_hashtable_iterator(size_type p, const hashtable_type* tab)
+		: pos(p), ht(tab) {}
+
+	reference operator*() const {return ht->slots[pos];}
+	pointer operator->() const {return &(operator*());}
+
+	iterator& operator++()
+	{
+		pos = ht->next_used(pos + 1);
+		return *this;
+	}
+
+	iterator operator++(int)
+	{
+		iterator temp = *this;
+		++*this;
+		return temp;
+	}
+
+	bool operator==(const iterator& it) const {return it.pos == pos;}
+	bool operator!=(const iterator& it) const {return it.pos != pos;}
+};
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class Alloc>
+struct __int_hashtable_const_iterator
+{
+	typedef int_hashtable<Value, Key, HashFun,
+						  ExtractKey, Alloc> hashtable_type;
+	typedef __int_hashtable_iterator<Value, Key, HashFun,
+									 ExtractKey, Alloc> iterator;
+	typedef __int_hashtable_const_iterator<Value, Key, HashFun,
+										   ExtractKey, Alloc> const_iterator;
+
+	typedef forward_iterator_tag iterator_category;
+	typedef Value value_type;
+	typedef ptrdiff_t difference_type;
+	typedef size_t size_type;
+	typedef const Value& reference;
+	typedef const Value* pointer;
+
+	size_type pos;
+	const hashtable_type* ht;
+
+	__int_hashtable_const_iterator(){}
+	__int_hashtable_const_iterator(size_type p, const hashtable_type* tab)
+		: pos(p), ht(tab) {}
+	__int_hashtable_const_iterator(const iterator& it)
+		: pos(it.pos), ht(it.ht) {}
+
+	reference operator*() const {return ht->slots[pos];}
+	pointer operator->() const {return &(operator*());}
+
+	const_iterator& operator++()
+	{
+		pos = ht->next_used(pos + 1);
+		return *this;
+	}
+
+	const_iterator operator++(int)
+	{
+		const_iterator temp = *this;
+		++*this;
+		return temp;
+	}
+
+	bool operator==(const const_iterator& it) const {return it.pos == pos;}
+	bool operator!=(const const_iterator& it) const {return it.pos != pos;}
+};
+
+// Spread the hash over all bits of size_t: hash<int> is the identity,
+// and sequential or strided ids would otherwise fill runs of slots
+inline size_t __int_hash_mix(size_t h)
+{
+#if defined(__SIZEOF_SIZE_T__) && __SIZEOF_SIZE_T__ == 8
+	// splitmix64 finalizer
+	h ^= h >> 30;
+	h *= (size_t(0xbf58476dUL) << 32) | 0x1ce4e5b9UL;
+	h ^= h >> 27;
+	h *= (size_t(0x94d049bbUL) << 32) | 0x133111ebUL;
+	h ^= h >> 31;
+#else
+	// murmur3 fmix32
+	h ^= h >> 16;
+	h *= 0x85ebca6bUL;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35UL;
+	h ^= h >> 16;
+#endif
+	return h;
+}
+
+// Map a mixed hash to [0, n) with the high half of h * n
+inline size_t __int_hash_range(size_t h, size_t n)
+{
+#if defined(__SIZEOF_INT128__) && __SIZEOF_SIZE_T__ == 8
+	return size_t(((unsigned __int128)h * n) >> 64);
+#else
+	return h % n;
+#endif
+}
+
+// @Value: used for map; for set, value = key
+// @Key: integral key, one value of it is the empty slot sentinel
+// @HashFun: input_value -> hash_value defined in "my_functors.h"
+// @ExtractKey: extract the key of a given value
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class Alloc>
+class int_hashtable
+{
+public:
+	typedef HashFun hasher;
+	typedef Key key_type;
+	typedef Value value_type;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	typedef value_type* pointer;
+	typedef const value_type* const_pointer;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+
+	typedef __int_hashtable_iterator<Value, Key, HashFun,
+									 ExtractKey, Alloc> iterator;
+	typedef __int_hashtable_const_iterator<Value, Key, HashFun,
+										   ExtractKey, Alloc> const_iterator;
+	friend struct __int_hashtable_iterator<Value, Key, HashFun,
+										   ExtractKey, Alloc>;
+	friend struct __int_hashtable_const_iterator<Value, Key, HashFun,
+												 ExtractKey, Alloc>;
+
+private:
+	typedef simple_alloc<value_type, Alloc> slot_allocator;
+
+	hasher hash;
+	ExtractKey get_key;
+
+	// capacity + 1 slots, the last one holds the sentinel key's element
+	value_type* slots;
+	size_type capacity;
+	size_type num_elements;
+	bool has_empty_key_elem;
+
+	// value copied into every free slot, its key is the sentinel
+	value_type empty_value;
+	key_type empty_key;
+
+	float max_load;
+	size_type grow_threshold;
+
+	enum {min_capacity = 8};
+
+	size_type home(const key_type& key) const
+	{return __int_hash_range(__int_hash_mix(hash(key)), capacity);}
+
+	size_type next_slot(size_type i) const
+	{return ++i == capacity ? 0 : i;}
+
+	bool is_free(size_type i) const
+	{return get_key(slots[i]) == empty_key;}
+
+	// First used position at or after pos, capacity + 1 is the end
+	size_type next_used(size_type pos) const
+	{
+		while(pos < capacity && is_free(pos))
+			++pos;
+		if(pos == capacity && !has_empty_key_elem)
+			++pos;
+		return pos;
+	}
+
+	void update_threshold()
+	{
+		grow_threshold = size_type(capacity * max_load);
+		if(grow_threshold >= capacity)
+			grow_threshold = capacity - 1; // keep one free slot
+	}
+
+	size_type capacity_for(size_type n) const
+	{
+		size_type c = size_type(n / max_load) + 1;
+		return c < min_capacity ? size_type(min_capacity) : c;
+	}
+
+	value_type* new_slots(size_type n)
+	{
+		value_type* p = slot_allocator::allocate(n + 1);
+		try {
+			uninitialized_fill_n(p, n + 1, empty_value);
+		}
+		catch(...){
+			slot_allocator::deallocate(p, n + 1);
+			throw;
+		}
+		return p;
+	}
+
+	void delete_slots(value_type* p, size_type n)
+	{
+		if(!p)
+			return;
+		destroy(p, p + n + 1);
+		slot_allocator::deallocate(p, n + 1);
+	}
+
+	// Slot of key, or capacity + 1 if absent
+	size_type find_pos(const key_type& key) const
+	{
+		if(key == empty_key)
+			return has_empty_key_elem ? capacity : capacity + 1;
+		for(size_type i = home(key); ; i = next_slot(i))
+		{
+			const key_type& k = get_key(slots[i]);
+			if(k == key)
+				return i;
+			if(k == empty_key)
+				return capacity + 1;
+		}
+	}
+
+	// Slot holding key or the free slot where it belongs
+	size_type probe(const key_type& key) const
+	{
+		size_type i = home(key);
+		while(!is_free(i) && !(get_key(slots[i]) == key))
+			i = next_slot(i);
+		return i;
+	}
+
+	// Move every element to a table of n slots, keys are known unique
+	void rebuild(size_type n)
+	{
+		value_type* tmp = new_slots(n);
+		value_type* old = slots;
+		size_type old_n = capacity;
+		slots = tmp;
+		capacity = n;
+		for(size_type i = 0; i < old_n; ++i)
+		{
+			if(!(get_key(old[i]) == empty_key))
+				slots[probe(get_key(old[i]))] = old[i];
+		}
+		slots[capacity] = old[old_n];
+		delete_slots(old, old_n);
+		update_threshold();
+	}
+
+	// Free slot i, shifting back the rest of its probe run so
+	// that no element ends up behind a free slot on its path
+	void erase_pos(size_type i)
+	{
+		for(size_type j = next_slot(i); !is_free(j); j = next_slot(j))
+		{
+			size_type k = home(get_key(slots[j]));
+			// j may fill the hole if i lies on its path [k, j)
+			size_type dist_k = j >= k ? j - k : j + capacity - k;
+			size_type dist_i = j >= i ? j - i : j + capacity - i;
+			if(dist_k >= dist_i)
+			{
+				slots[i] = slots[j];
+				i = j;
+			}
+		}
+		slots[i] = empty_value;
+		--num_elements;
+	}
+
+	void init(size_type n)
+	{
+		capacity = capacity_for(n);
+		slots = new_slots(capacity);
+		num_elements = 0;
+		has_empty_key_elem = false;
+		update_threshold();
+	}
+
+public:
+	int_hashtable(size_type n, const hasher& hf,
+				  const value_type& empty_val)
+		: hash(hf), get_key(ExtractKey()), slots(0),
+		  empty_value(empty_val), empty_key(get_key(empty_val)),
+		  max_load(0.8f)
+	{
+		init(n);
+	}
+
+	int_hashtable(const int_hashtable& ht)
+		: hash(ht.hash), get_key(ht.get_key), slots(0),
+		  capacity(ht.capacity), num_elements(ht.num_elements),
+		  has_empty_key_elem(ht.has_empty_key_elem),
+		  empty_value(ht.empty_value), empty_key(ht.empty_key),
+		  max_load(ht.max_load), grow_threshold(ht.grow_threshold)
+	{
+		slots = slot_allocator::allocate(capacity + 1);
+		try {
+			uninitialized_copy(ht.slots, ht.slots + capacity + 1, slots);
+		}
+		catch(...){
+			slot_allocator::deallocate(slots, capacity + 1);
+			throw;
+		}
+	}
+
+	int_hashtable& operator=(const int_hashtable& ht)
+	{
+		if(this != &ht)
+		{
+			int_hashtable temp(ht);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~int_hashtable() {delete_slots(slots, capacity);}
+
+	void swap(int_hashtable& ht)
+	{
+		fyj::swap(hash, ht.hash);
+		fyj::swap(slots, ht.slots);
+		fyj::swap(capacity, ht.capacity);
+		fyj::swap(num_elements, ht.num_elements);
+		fyj::swap(has_empty_key_elem, ht.has_empty_key_elem);
+		fyj::swap(empty_value, ht.empty_value);
+		fyj::swap(empty_key, ht.empty_key);
+		fyj::swap(max_load, ht.max_load);
+		fyj::swap(grow_threshold, ht.grow_threshold);
+	}
+
+	hasher hash_fun() const {return hash;}
+	key_type empty_key_value() const {return empty_key;}
+
+	size_type size() const
+	{return num_elements + (has_empty_key_elem ? 1 : 0);}
+	size_type max_size() const {return size_type(-1) / sizeof(value_type);}
+	bool empty() const {return size() == 0;}
+
+	size_type bucket_count() const {return capacity;}
+	float load_factor() const {return float(num_elements) / capacity;}
+	float max_load_factor() const {return max_load;}
+	void max_load_factor(float z)
+	{
+		max_load = z;
+		update_threshold();
+		if(num_elements > grow_threshold)
+			rebuild(capacity_for(num_elements));
+	}
+
+	// Size the table for n elements at once (never shrinks)
+	void reserve(size_type n)
+	{
+		size_type c = capacity_for(n);
+		if(c > capacity)
+			rebuild(c);
+	}
+
+	iterator begin() {return iterator(next_used(0), this);}
+	iterator end() {return iterator(capacity + 1, this);}
+	const_iterator begin() const
+	{return const_iterator(next_used(0), this);}
+	const_iterator end() const {return const_iterator(capacity + 1, this);}
+
+public:
+	pair<iterator, bool> insert_unique(const value_type& obj)
+	{
+		const key_type& key = get_key(obj);
+		if(key == empty_key)
+		{
+			bool inserted = !has_empty_key_elem;
+			if(inserted)
+			{
+				slots[capacity] = obj;
+				has_empty_key_elem = true;
+			}
+			return pair<iterator, bool>(iterator(capacity, this), inserted);
+		}
+		// A key already in never grows the table
+		size_type i = probe(key);
+		if(!is_free(i))
+			return pair<iterator, bool>(iterator(i, this), false);
+		if(num_elements >= grow_threshold)
+		{
+			rebuild(capacity * 2);
+			i = probe(key);
+		}
+		slots[i] = obj;
+		++num_elements;
+		return pair<iterator, bool>(iterator(i, this), true);
+	}
+
+	template <class InputIterator>
+	void insert_unique(InputIterator first, InputIterator last)
+	{
+		for(; first != last; ++first)
+			insert_unique(*first);
+	}
+
+	// Slot for key, inserted with value v if absent
+	reference find_or_insert(const value_type& v)
+	{return *insert_unique(v).first;}
+
+	iterator find(const key_type& key)
+	{return iterator(find_pos(key), this);}
+	const_iterator find(const key_type& key) const
+	{return const_iterator(find_pos(key), this);}
+
+	size_type count(const key_type& key) const
+	{return find_pos(key) <= capacity ? 1 : 0;}
+
+	void erase(const_iterator it)
+	{
+		if(it.pos == capacity)
+		{
+			slots[capacity] = empty_value;
+			has_empty_key_elem = false;
+		}
+		else
+			erase_pos(it.pos);
+	}
+
+	size_type erase(const key_type& key)
+	{
+		size_type i = find_pos(key);
+		if(i > capacity)
+			return 0;
+		erase(const_iterator(i, this));
+		return 1;
+	}
+
+	void clear()
+	{
+		fill(slots, slots + capacity + 1, empty_value);
+		num_elements = 0;
+		has_empty_key_elem = false;
+	}
+};
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * Interval map: values keyed by half-open intervals [low, high),
+ * ordered by low then high; equal intervals are allowed (like multimap)
+ *
+ * Implemented by an augmented RB_tree: each node keeps the largest
+ * high of its subtree, so an overlap query skips every subtree that
+ * ends before the query starts, and stops at the first node that
+ * starts after it ends. A node is visited only if it overlaps, or is
+ * an ancestor of one that does (or of the node that stops the walk):
+ * the k overlaps of [lo, hi) cost O(min(n, (k + 1) log n)), close to
+ * O(log n + k) when they are clustered, instead of a scan of the map.
+ */
+
+#ifndef _MY_INTERVAL_MAP_
+#define _MY_INTERVAL_MAP_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_algo.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_rb_tree.h"
+
+namespace fyj
+{
+
+// [low, high)
+template <class Key>
+struct interval
+{
+	Key low;
+	Key high;
+
+	interval() : low(), high() {}
+	interval(const Key& l, const Key& h) : low(l), high(h) {}
+};
+
+template <class Key>
+inline bool operator==(const interval<Key>& x, const interval<Key>& y)
+{
+	return x.low == y.low && x.high == y.high;
+}
+
+template <class Key>
+inline bool operator!=(const interval<Key>& x, const interval<Key>& y)
+{
+	return !(x == y);
+}
+
+template <class Key>
+inline bool operator<(const interval<Key>& x, const interval<Key>& y)
+{
+	return x.low < y.low || (!(y.low < x.low) && x.high < y.high);
+}
+
+// Order of the tree: by low, then by high
+template <class Key, class Compare>
+struct __interval_less
+{
+	bool operator()(const interval<Key>& x, const interval<Key>& y) const
+	{
+		Compare comp;
+		return comp(x.low, y.low) ||
+			   (!comp(y.low, x.low) && comp(x.high, y.high));
+	}
+};
+
+// meta: the largest high in the subtree
+template <class Key, class Compare>
+struct __interval_augment
+{
+	typedef Key meta_type;
+
+	template <class Node>
+	static void update(Node* x)
+	{
+		Compare comp;
+		x->meta = x->value.first.high;
+		Node* l = static_cast<Node*>(x->left);
+		Node* r = static_cast<Node*>(x->right);
+		if(l && comp(x->meta, l->meta))
+			x->meta = l->meta;
+		if(r && comp(x->meta, r->meta))
+			x->meta = r->meta;
+	}
+};
+
+template <class Key, class T, class Compare = less<Key>, class Alloc = alloc>
+class interval_map
+{
+public:
+	typedef fyj::interval<Key>      interval_type;
+	typedef interval_type 			key_type;
+	typedef T 				   		mapped_type;
+	typedef pair<const interval_type, T> value_type;
+
+private:
+	typedef rb_tree<interval_type, value_type, select1st<value_type>,
+					__interval_less<Key, Compare>, Alloc,
+					__interval_augment<Key, Compare> > tree_type;
+	typedef typename tree_type::link_type link_type;
+	tree_type t;
+	Compare comp;
+
+	static link_type left(link_type x) {return (link_type)x->left;}
+	static link_type right(link_type x) {return (link_type)x->right;}
+
+	// Does x overlap [lo, hi)
+	bool overlaps(link_type x, const Key& lo, const Key& hi) const
+	{
+		return comp(x->value.first.low, hi) && comp(lo, x->value.first.high);
+	}
+
+	// In order over the subtree x; a subtree whose largest high is
+	// <= lo holds no overlap, a node whose low is >= hi ends the walk
+	// (all the nodes after it start later). false once stopped
+	template <class Function>
+	bool __for_each_overlap(link_type x, const Key& lo, const Key& hi,
+							Function& f) const
+	{
+		for(; x && comp(lo, x->meta); x = right(x))
+		{
+			if(!__for_each_overlap(left(x), lo, hi, f))
+				return false;
+			if(!comp(x->value.first.low, hi))
+				return false;
+			if(comp(lo, x->value.first.high))
+				f(x->value);
+		}
+		return true;
+	}
+
+	struct counter
+	{
+		size_t n;
+		counter() : n(0) {}
+		void operator()(const value_type&) {++n;}
+	};
+
+public:
+	typedef typename tree_type::pointer             pointer;
+	typedef typename tree_type::const_pointer 	    const_pointer;
+	typedef typename tree_type::reference           reference;
+	typedef typename tree_type::const_reference     const_reference;
+	typedef typename tree_type::iterator            iterator;
+	typedef typename tree_type::const_iterator      const_iterator;
+	typedef typename tree_type::size_type 		     size_type;
+	typedef typename tree_type::difference_type      difference_type;
+
+	// No constructor from a Compare: the order of the tree and the
+	// augment update build their own, so Compare must be stateless
+	interval_map() : t(), comp() {}
+
+	interval_map(const interval_map<Key, T, Compare, Alloc>& x)
+		: t(x.t), comp(x.comp) {}
+
+	interval_map<Key, T, Compare, Alloc>&
+	operator=(const interval_map<Key, T, Compare, Alloc>& x)
+	{
+		t = x.t;
+		comp = x.comp;
+		return *this;
+	}
+
+	iterator begin() const {return t.begin();}
+	iterator end() const {return t.end();}
+	bool empty() const {return t.empty();}
+	size_type size() const {return t.size();}
+	size_type max_size() const {return t.max_size();}
+
+	void swap(interval_map<Key, T, Compare, Alloc>& x)
+	{
+		t.swap(x.t);
+		fyj::swap(comp, x.comp);
+	}
+
+	// After the equal intervals
+	iterator insert(const value_type& x) {return t.insert_equal(x);}
+	iterator insert(const Key& lo, const Key& hi, const T& x)
+	{
+		return t.insert_equal(value_type(interval_type(lo, hi), x));
+	}
+
+	// Return the iterator after pos
+	iterator erase(iterator pos) {return t.erase(pos);}
+	// Erase the values keyed by exactly [i.low, i.high)
+	size_type erase(const interval_type& i) {return t.erase(i);}
+	void clear() {t.clear();}
+
+	// The first value keyed by exactly [i.low, i.high)
+	iterator find(const interval_type& i) const {return t.find(i);}
+
+	//================ OVERLAP QUERIES =========================
+	// The first interval (in order) overlapping [lo, hi), or end(): O(log n)
+	// If the left subtree has an interval ending after lo but none of
+	// its intervals overlaps, that one starts at or after hi, and so
+	// does everything on its right: the answer is on the left or nowhere
+	iterator find_overlap(const Key& lo, const Key& hi) const
+	{
+		link_type x = t.root_node();
+		while(x)
+		{
+			link_type l = left(x);
+			if(l && comp(lo, l->meta))
+				x = l;
+			else if(overlaps(x, lo, hi))
+				return iterator(x);
+			else if(!comp(x->value.first.low, hi))
+				break;
+			else
+				x = right(x);
+		}
+		return end();
+	}
+
+	// f(value) for every value whose interval overlaps [lo, hi), in order
+	template <class Function>
+	Function for_each_overlap(const Key& lo, const Key& hi, Function f) const
+	{
+		__for_each_overlap(t.root_node(), lo, hi, f);
+		return f;
+	}
+
+	size_type count_overlaps(const Key& lo, const Key& hi) const
+	{
+		return for_each_overlap(lo, hi, counter()).n;
+	}
+
+	friend bool operator==(const interval_map<Key, T, Compare, Alloc>& x,
+						   const interval_map<Key, T, Compare, Alloc>& y)
+	{
+		return x.t == y.t;
+	}
+
+	friend bool operator< (const interval_map<Key, T, Compare, Alloc>& x,
+						   const interval_map<Key, T, Compare, Alloc>& y)
+	{
+		return x.t < y.t;
+	}
+};
+
+}
+
+#endif
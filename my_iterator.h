@@ -95,6 +95,80 @@ value_type(const Iterator&)
 {
 	return static_cast<typename iterator_traits<Iterator>::value_type*>(0);
 }
+
+
+// Walk a bidirectional iterator backwards
+// *r is the element before r.base(), so rbegin() is reverse_iterator(end())
+template <class Iterator>
+class reverse_iterator
+{
+protected:
+	Iterator current;
+
+public:
+	typedef typename iterator_traits<Iterator>::iterator_category
+		iterator_category;
+	typedef typename iterator_traits<Iterator>::value_type 		 value_type;
+	typedef typename iterator_traits<Iterator>::difference_type	 difference_type;
+	typedef typename iterator_traits<Iterator>::pointer 			 pointer;
+	typedef typename iterator_traits<Iterator>::reference     	 reference;
+	typedef Iterator iterator_type;
+	typedef reverse_iterator<Iterator> self;
+
+	reverse_iterator() {}
+	explicit reverse_iterator(iterator_type x) : current(x) {}
+	// e.g. reverse iterator to reverse const_iterator
+	template <class Iter>
+	reverse_iterator(const reverse_iterator<Iter>& x) : current(x.base()) {}
+
+	iterator_type base() const {return current;}
+
+	reference operator*() const
+	{
+		Iterator temp = current;
+		return *--temp;
+	}
+	pointer operator->() const {return &(operator*());}
+
+	self& operator++()
+	{
+		--current;
+		return *this;
+	}
+	self operator++(int)
+	{
+		self temp = *this;
+		--current;
+		return temp;
+	}
+
+	self& operator--()
+	{
+		++current;
+		return *this;
+	}
+	self operator--(int)
+	{
+		self temp = *this;
+		++current;
+		return temp;
+	}
+};
+
+// Also between reverse iterator and reverse const_iterator
+template <class Iterator1, class Iterator2>
+inline bool operator==(const reverse_iterator<Iterator1>& x,
+					   const reverse_iterator<Iterator2>& y)
+{
+	return x.base() == y.base();
+}
+
+template <class Iterator1, class Iterator2>
+inline bool operator!=(const reverse_iterator<Iterator1>& x,
+					   const reverse_iterator<Iterator2>& y)
+{
+	return !(x.base() == y.base());
+}
 		   
 
 } //end of namespace
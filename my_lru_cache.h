@@ -0,0 +1,434 @@
+/* Fixed capacity caches on top of "my_hash_table.h"
+ *
+ * lru_cache: evicts the least recently used entry.
+ * The recency links live in the element of the hash node itself
+ * (intrusive doubly linked list), so an entry costs one allocation,
+ * and get / put / evict are O(1) with a single hash lookup. Chaining
+ * never moves a node, so the links stay valid across rehashes.
+ * A get moves the entry to the front: it writes to the list.
+ *
+ * clock_cache: CLOCK (second chance) approximation of LRU.
+ * Entries sit in a ring of Capacity slots, each with a "referenced"
+ * flag. A get only sets the flag of its entry (no pointer update, and
+ * no write at all if the flag is already set); an eviction sweeps the
+ * ring, clearing flags, and evicts the first entry whose flag is clear.
+ * So lookups can be served concurrently under a shared lock (e.g. a
+ * pthread_rwlock read lock) as long as put / erase take it exclusively:
+ * const get() only reads the table and stores the flag (atomically
+ * with GCC / Clang).
+ *
+ * Capacity must be > 0.
+ */
+
+#ifndef _MY_LRU_CACHE_
+#define _MY_LRU_CACHE_
+
+#include <stddef.h>
+#include "my_alloc.h"
+#include "my_algo.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_vector.h"
+#include "my_hash_table.h"
+
+namespace fyj
+{
+
+//========================= LRU ==========================================
+
+struct __lru_links
+{
+	__lru_links* prev;	// more recent
+	__lru_links* next;	// less recent
+};
+
+template <class Key, class T>
+struct __lru_entry : public __lru_links
+{
+	pair<const Key, T> kv;
+
+	__lru_entry(const Key& k, const T& v) : kv(k, v) {prev = next = 0;}
+};
+
+// Key of a cache entry, ExtractKey of the hashtable
+template <class Key, class Entry>
+struct __cache_entry_key
+{
+	const Key& operator()(const Entry& e) const {return e.kv.first;}
+};
+
+template <class Key,
+		  class T,
+		  size_t Capacity,
+		  class HashFun = hash<Key>,
+		  class EqualKey = equal_to<Key>,
+		  class Alloc = alloc>
+class lru_cache
+{
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef pair<const Key, T> value_type;
+	typedef HashFun hasher;
+	typedef EqualKey key_equal;
+	typedef size_t size_type;
+
+private:
+	typedef __lru_entry<Key, T> entry;
+	typedef hashtable<entry, Key, HashFun, __cache_entry_key<Key, entry>,
+					  EqualKey, Alloc> table;
+
+	table ht;
+	// head.next: most recent, head.prev: least recent
+	__lru_links head;
+
+	void link_front(__lru_links* e)
+	{
+		e->prev = &head;
+		e->next = head.next;
+		head.next->prev = e;
+		head.next = e;
+	}
+
+	static void unlink(__lru_links* e)
+	{
+		e->prev->next = e->next;
+		e->next->prev = e->prev;
+	}
+
+	void move_front(__lru_links* e)
+	{
+		if(head.next != e)
+		{
+			unlink(e);
+			link_front(e);
+		}
+	}
+
+	entry* lookup(const key_type& key) const
+	{
+		typename table::const_iterator it = ht.find(key);
+		return it == ht.end() ? 0 : const_cast<entry*>(&*it);
+	}
+
+	// The sentinel moved with a swap: point the ends back at it
+	void fix_head()
+	{
+		if(ht.empty())
+			head.prev = head.next = &head;
+		else
+		{
+			head.next->prev = &head;
+			head.prev->next = &head;
+		}
+	}
+
+public:
+	// One more bucket slot than Capacity: put links the new entry
+	// before it evicts, the table never grows
+	explicit lru_cache(const hasher& hf = hasher(),
+					   const key_equal& eql = key_equal())
+		: ht(Capacity + 1, hf, eql)
+	{
+		ht.reserve(Capacity + 1);
+		head.prev = head.next = &head;
+	}
+
+	// Same entries, same recency order
+	lru_cache(const lru_cache& x)
+		: ht(Capacity + 1, x.ht.hash_fun(), x.ht.key_eq())
+	{
+		ht.reserve(Capacity + 1);
+		head.prev = head.next = &head;
+		for(const __lru_links* e = x.head.prev; e != &x.head; e = e->prev)
+			put(static_cast<const entry*>(e)->kv.first,
+				static_cast<const entry*>(e)->kv.second);
+	}
+
+	lru_cache& operator=(const lru_cache& x)
+	{
+		if(this != &x)
+		{
+			lru_cache temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	void swap(lru_cache& x)
+	{
+		ht.swap(x.ht);
+		fyj::swap(head, x.head);
+		fix_head();
+		x.fix_head();
+	}
+
+	size_type size() const {return ht.size();}
+	size_type capacity() const {return Capacity;}
+	bool empty() const {return ht.empty();}
+
+	// Value of key, now the most recent entry; 0 if key is missing
+	T* get(const key_type& key)
+	{
+		entry* e = lookup(key);
+		if(!e)
+			return 0;
+		move_front(e);
+		return &e->kv.second;
+	}
+
+	// Like get, but the recency order is left alone
+	const T* peek(const key_type& key) const
+	{
+		const entry* e = lookup(key);
+		return e ? &e->kv.second : 0;
+	}
+
+	bool contains(const key_type& key) const {return lookup(key) != 0;}
+
+	// Insert or overwrite key, which becomes the most recent entry.
+	// A full cache first evicts its least recent entry.
+	// true if key was not in the cache
+	bool put(const key_type& key, const T& val)
+	{
+		pair<typename table::iterator, bool> p =
+			ht.insert_unique_noresize(entry(key, val));
+		entry* e = &*p.first;
+		if(!p.second)
+		{
+			e->kv.second = val;
+			move_front(e);
+			return false;
+		}
+		link_front(e);
+		if(ht.size() > Capacity)
+		{
+			entry* last = static_cast<entry*>(head.prev);
+			unlink(last);
+			ht.erase(last->kv.first);
+		}
+		return true;
+	}
+
+	bool erase(const key_type& key)
+	{
+		entry* e = lookup(key);
+		if(!e)
+			return false;
+		unlink(e);
+		ht.erase(key);
+		return true;
+	}
+
+	void clear()
+	{
+		ht.clear();
+		head.prev = head.next = &head;
+	}
+};
+
+//========================= CLOCK ========================================
+
+template <class Key, class T>
+struct __clock_entry
+{
+	pair<const Key, T> kv;
+	size_t slot;						// index in the ring
+	mutable unsigned char referenced;	// set by get, cleared by the hand
+
+	__clock_entry(const Key& k, const T& v, size_t s)
+		: kv(k, v), slot(s), referenced(0) {}
+};
+
+template <class Key,
+		  class T,
+		  size_t Capacity,
+		  class HashFun = hash<Key>,
+		  class EqualKey = equal_to<Key>,
+		  class Alloc = alloc>
+class clock_cache
+{
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef pair<const Key, T> value_type;
+	typedef HashFun hasher;
+	typedef EqualKey key_equal;
+	typedef size_t size_type;
+
+private:
+	typedef __clock_entry<Key, T> entry;
+	typedef hashtable<entry, Key, HashFun, __cache_entry_key<Key, entry>,
+					  EqualKey, Alloc> table;
+
+	table ht;
+	vector<entry*, Alloc> ring;			// Capacity slots, 0 = free
+	vector<size_type, Alloc> free_slots;
+	size_type hand;
+
+	entry* lookup(const key_type& key) const
+	{
+		typename table::const_iterator it = ht.find(key);
+		return it == ht.end() ? 0 : const_cast<entry*>(&*it);
+	}
+
+	// The flag may be set by several readers at once
+	static void mark(const entry* e)
+	{
+#if defined(__GNUC__)
+		if(!__atomic_load_n(&e->referenced, __ATOMIC_RELAXED))
+			__atomic_store_n(&e->referenced, (unsigned char)1,
+							 __ATOMIC_RELAXED);
+#else
+		if(!e->referenced)
+			e->referenced = 1;
+#endif
+	}
+
+	// Sweep to the first entry not referenced since the last sweep,
+	// evict it and return its slot
+	size_type evict()
+	{
+		for(;;)
+		{
+			entry* e = ring[hand];
+			const size_type slot = hand;
+			hand = hand + 1 == Capacity ? 0 : hand + 1;
+			if(!e->referenced)
+			{
+				ht.erase(e->kv.first);
+				return slot;
+			}
+			e->referenced = 0;
+		}
+	}
+
+	void init_slots()
+	{
+		vector<entry*, Alloc> temp(Capacity, (entry*)0);
+		ring.swap(temp);
+		// slot 0 on top
+		vector<size_type, Alloc> temp_free(Capacity, size_type(0));
+		for(size_type i = 0; i < Capacity; ++i)
+			temp_free[i] = Capacity - 1 - i;
+		free_slots.swap(temp_free);
+		hand = 0;
+	}
+
+public:
+	explicit clock_cache(const hasher& hf = hasher(),
+						 const key_equal& eql = key_equal())
+		: ht(Capacity, hf, eql)
+	{
+		ht.reserve(Capacity);
+		init_slots();
+	}
+
+	// Same entries in the same slots, flags and hand included
+	clock_cache(const clock_cache& x)
+		: ht(Capacity, x.ht.hash_fun(), x.ht.key_eq()),
+		  free_slots(x.free_slots), hand(x.hand)
+	{
+		ht.reserve(Capacity);
+		vector<entry*, Alloc> temp(Capacity, (entry*)0);
+		ring.swap(temp);
+		for(size_type i = 0; i < Capacity; ++i)
+		{
+			if(const entry* e = x.ring.begin()[i])
+			{
+				entry* copy = &*ht.insert_unique_noresize(*e).first;
+				copy->referenced = e->referenced;
+				ring[i] = copy;
+			}
+		}
+	}
+
+	clock_cache& operator=(const clock_cache& x)
+	{
+		if(this != &x)
+		{
+			clock_cache temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	// Nodes do not move: the ring pointers go along with the table
+	void swap(clock_cache& x)
+	{
+		ht.swap(x.ht);
+		ring.swap(x.ring);
+		free_slots.swap(x.free_slots);
+		fyj::swap(hand, x.hand);
+	}
+
+	size_type size() const {return ht.size();}
+	size_type capacity() const {return Capacity;}
+	bool empty() const {return ht.empty();}
+
+	// Value of key, marked as referenced; 0 if key is missing
+	T* get(const key_type& key)
+	{
+		entry* e = lookup(key);
+		if(!e)
+			return 0;
+		mark(e);
+		return &e->kv.second;
+	}
+
+	// The read-mostly path: safe beside other const gets
+	const T* get(const key_type& key) const
+	{
+		const entry* e = lookup(key);
+		if(!e)
+			return 0;
+		mark(e);
+		return &e->kv.second;
+	}
+
+	bool contains(const key_type& key) const {return lookup(key) != 0;}
+
+	// Insert or overwrite key. A full cache first evicts one entry.
+	// A new entry starts unreferenced; an overwrite marks it.
+	// true if key was not in the cache
+	bool put(const key_type& key, const T& val)
+	{
+		if(entry* e = lookup(key))
+		{
+			e->kv.second = val;
+			mark(e);
+			return false;
+		}
+		size_type slot;
+		if(free_slots.empty())
+			slot = evict();
+		else
+		{
+			slot = free_slots.back();
+			free_slots.pop_back();
+		}
+		ring[slot] = &*ht.insert_unique_noresize(entry(key, val, slot)).first;
+		return true;
+	}
+
+	bool erase(const key_type& key)
+	{
+		entry* e = lookup(key);
+		if(!e)
+			return false;
+		ring[e->slot] = 0;
+		free_slots.push_back(e->slot);
+		ht.erase(key);
+		return true;
+	}
+
+	void clear()
+	{
+		ht.clear();
+		init_slots();
+	}
+};
+
+} // end of namespace
+
+#endif
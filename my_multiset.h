@@ -18,7 +18,8 @@
 namespace fyj
 {
 
-template <class Key, class Compare = less<Key>, class Alloc = alloc>
+template <class Key, class Compare = less<Key>, class Alloc = alloc,
+		  class Augment = no_augment>
 class multiset
 {
 public:
@@ -29,7 +30,7 @@ public:
 
 private:
 	typedef rb_tree<key_type, value_type, identity<value_type>,
-					key_compare, Alloc> tree_type;
+					key_compare, Alloc, Augment> tree_type;
 	tree_type t;
 
 public:
@@ -44,53 +45,122 @@ public:
 	typedef typename tree_type::const_reverse_iterator    const_reverse_iterator;
 	typedef typename tree_type::size_type 		   size_type;
 	typedef typename tree_type::difference_type    difference_type;
+	typedef typename tree_type::node_type          node_type;
 
 	multiset() : t(Compare()) {}
 	explicit multiset(const Compare& comp) : t(comp){}
 
-	// template <class InputIterator>
-	// set(InputIterator first, InputIterator last)
-	// 	: t(Compare()) {t.insert_unique(first, last);}
-	// template <class InputIterator>
-	// set(InputIterator first, InputIterator last, const Compare& comp)
-	// 	: t(comp) {t.insert_unique(first, last);}
+	// O(n) if [first, last) is sorted, see rb_tree::insert_equal
+	template <class InputIterator>
+	multiset(InputIterator first, InputIterator last)
+		: t(Compare()) {t.insert_equal(first, last);}
+	template <class InputIterator>
+	multiset(InputIterator first, InputIterator last, const Compare& comp)
+		: t(comp) {t.insert_equal(first, last);}
 
-	multiset(const multiset<Key, Compare, Alloc>& x) : t(x.t) {}
+	multiset(const multiset<Key, Compare, Alloc, Augment>& x) : t(x.t) {}
 
-	multiset<Key, Compare, Alloc>& operator=(const multiset<Key, Compare, Alloc>& x)
+	multiset<Key, Compare, Alloc, Augment>& operator=(const multiset<Key, Compare, Alloc, Augment>& x)
 	{
 		t = x.t;
 		return *this;
 	}
 
-	key_compare key_comp() const {return t.key_comp;}
-	value_compare value_comp() const {return t.key_comp;}
+	key_compare key_comp() const {return t.key_comp();}
+	value_compare value_comp() const {return t.key_comp();}
 	iterator begin() const {return t.begin();}
 	iterator end() const {return t.end();}
+	reverse_iterator rbegin() const {return t.rbegin();}
+	reverse_iterator rend() const {return t.rend();}
 	bool empty() const {return t.empty();}
 	size_type size() const {return t.size();}
 	size_type max_size() const {return t.max_size();}
-	void swap(multiset<Key, Compare, Alloc>& x) {t.swap(x.t);}
+	void swap(multiset<Key, Compare, Alloc, Augment>& x) {t.swap(x.t);}
 
-	pair<iterator, bool> insert(const value_type& x)
+	iterator insert(const value_type& x)
 	{
-		pair<typename tree_type::iterator, bool> p = t.insert_equal(x);
-		return pair<iterator, bool>(p.first, p.second);
+		return t.insert_equal(x);
 	}
 
+	// Amortized O(1) when x goes right before position
+	iterator insert(iterator position, const value_type& x)
+	{
+		return t.insert_equal((typename tree_type::iterator&)position, x);
+	}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		t.insert_equal(first, last);
+	}
+
+	// Return the iterator after pos
+	iterator erase(iterator pos)
+	{return t.erase((typename tree_type::iterator&)pos);}
+	size_type erase(const key_type& x) {return t.erase(x);}
+	iterator erase(iterator first, iterator last)
+	{
+		return t.erase((typename tree_type::iterator&)first,
+					   (typename tree_type::iterator&)last);
+	}
 	void clear() {t.clear();}
 
-	iterator find(const key_type& x) const {return t.find();}
-	//size_type count(const key_type& x) const {return t.count(x);}
+	// Node handles: move elements between sets without reallocation
+	node_type extract(iterator pos)
+	{return t.extract((typename tree_type::iterator&)pos);}
+	node_type extract(const key_type& x) {return t.extract(x);}
+	iterator insert(node_type& nh) {return t.insert_equal(nh);}
+	void merge(multiset<Key, Compare, Alloc, Augment>& x) {t.merge_equal(x.t);}
+
+	// With Augment = rank_augment, see rb_tree: O(log n)
+	iterator select(size_type k) const {return t.select(k);}
+	size_type rank(const key_type& x) const {return t.rank(x);}
+	difference_type distance(iterator first, iterator last) const
+	{return t.distance(first, last);}
+
+	iterator find(const key_type& x) const {return t.find(x);}
+	// Transparent find, see rb_tree::find
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	find(const K& x) const {return t.find(x);}
+	size_type count(const key_type& x) const {return t.count(x);}
+
+	iterator lower_bound(const key_type& x) const {return t.lower_bound(x);}
+	iterator upper_bound(const key_type& x) const {return t.upper_bound(x);}
+	pair<iterator, iterator> equal_range(const key_type& x) const
+	{
+		pair<typename tree_type::iterator, typename tree_type::iterator> p =
+			t.equal_range(x);
+		return pair<iterator, iterator>(p.first, p.second);
+	}
+
+	// Transparent versions, see rb_tree::find
+	template <class K>
+	typename __if_transparent<K, size_type, Compare>::type
+	count(const K& x) const {return t.count(x);}
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	lower_bound(const K& x) const {return t.lower_bound(x);}
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	upper_bound(const K& x) const {return t.upper_bound(x);}
+	template <class K>
+	typename __if_transparent<K, pair<iterator, iterator>, Compare>::type
+	equal_range(const K& x) const
+	{
+		pair<typename tree_type::iterator, typename tree_type::iterator> p =
+			t.equal_range(x);
+		return pair<iterator, iterator>(p.first, p.second);
+	}
 
-	friend bool operator==(const multiset<Key, Compare, Alloc>& x,
-						   const multiset<Key, Compare, Alloc>& y,)
+	friend bool operator==(const multiset<Key, Compare, Alloc, Augment>& x,
+						   const multiset<Key, Compare, Alloc, Augment>& y)
 	{
 		return x.t == y.t;
 	}
 
-	friend bool operator< (const multiset<Key, Compare, Alloc>& x,
-						   const multiset<Key, Compare, Alloc>& y,)
+	friend bool operator< (const multiset<Key, Compare, Alloc, Augment>& x,
+						   const multiset<Key, Compare, Alloc, Augment>& y)
 	{
 		return x.t < y.t;
 	}
@@ -0,0 +1,99 @@
+/* Node handle: owns one node taken out of a container by extract()
+ *
+ * Moving an element between two containers of the same type with
+ * extract() and insert() only relinks the node: no allocation, no free
+ * and no copy of the value.
+ * If a handle still owns a node when it dies, Destroy frees it: by
+ * default the value is destroyed and the node given back to Alloc. A
+ * container whose nodes hold more than the value passes its own.
+ *
+ * Ownership moves on copy, like auto_ptr: the source becomes empty.
+ * __node_handle_ref lets a temporary (e.g. the result of extract()) be
+ * moved as well.
+ */
+
+#ifndef _MY_NODE_HANDLE_
+#define _MY_NODE_HANDLE_
+
+#include "my_alloc.h"
+#include "my_construct.h"
+
+namespace fyj
+{
+
+template <class Node>
+struct __node_handle_ref
+{
+	Node* ptr;
+	explicit __node_handle_ref(Node* p) : ptr(p) {}
+};
+
+// The default Destroy of __node_handle
+template <class Node, class Value, Value Node::*Field, class Alloc>
+void __node_handle_destroy(Node* p)
+{
+	destroy(&(p->*Field));
+	simple_alloc<Node, Alloc>::deallocate(p);
+}
+
+// @Node: node type of the container
+// @Value: value type stored in the node
+// @Field: the member of Node holding the value
+// @Destroy: destroys and frees a node the handle owns
+template <class Node, class Value, Value Node::*Field, class Alloc,
+		  void (*Destroy)(Node*) = &__node_handle_destroy<Node, Value,
+														 Field, Alloc> >
+class __node_handle
+{
+public:
+	typedef Value value_type;
+
+private:
+	Node* ptr;
+
+public:
+	__node_handle() : ptr(0) {}
+	explicit __node_handle(Node* p) : ptr(p) {}
+	__node_handle(__node_handle& x) : ptr(x.release()) {}
+	__node_handle(__node_handle_ref<Node> r) : ptr(r.ptr) {}
+	~__node_handle() {reset(0);}
+
+	__node_handle& operator=(__node_handle& x)
+	{
+		reset(x.release());
+		return *this;
+	}
+	__node_handle& operator=(__node_handle_ref<Node> r)
+	{
+		reset(r.ptr);
+		return *this;
+	}
+	operator __node_handle_ref<Node>()
+	{
+		return __node_handle_ref<Node>(release());
+	}
+
+	bool empty() const {return ptr == 0;}
+	// The value may be changed while the node is out of any container
+	value_type& value() const {return ptr->*Field;}
+
+	// Used by containers to look at / take the node back
+	Node* get() const {return ptr;}
+	Node* release()
+	{
+		Node* p = ptr;
+		ptr = 0;
+		return p;
+	}
+
+	void reset(Node* p)
+	{
+		if(ptr && ptr != p)
+			Destroy(ptr);
+		ptr = p;
+	}
+};
+
+} // end of namespace
+
+#endif
@@ -14,8 +14,29 @@ struct pair
 	T2 second;
 	pair():first(T1()),second(T2()) {}
 	pair(const T1& a, const T2& b):first(a),second(b) {}
+	// e.g. pair<const Key, T> from pair<Key, T>
+	template <class U1, class U2>
+	pair(const pair<U1, U2>& p):first(p.first),second(p.second) {}
 };
 
+template <class T1, class T2>
+inline bool operator==(const pair<T1, T2>& x, const pair<T1, T2>& y)
+{
+	return x.first == y.first && x.second == y.second;
+}
+
+template <class T1, class T2>
+inline bool operator!=(const pair<T1, T2>& x, const pair<T1, T2>& y)
+{
+	return !(x == y);
+}
+
+template <class T1, class T2>
+inline bool operator<(const pair<T1, T2>& x, const pair<T1, T2>& y)
+{
+	return x.first < y.first || (!(y.first < x.first) && x.second < y.second);
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,415 @@
+/* Static map with a perfect hash (CHD: hash, displace and compress)
+ *
+ * Built once from a key range, then read only. Each key gets a slot
+ * of its own, so a lookup is one slot read and one key comparison:
+ *     # keys are split into small buckets by a first hash
+ *     # each bucket, largest first, gets a displacement index k:
+ *       the first k for which the second hash of all its keys lands
+ *       on slots still free
+ *     # a lookup hashes the key, reads the displacement of its bucket
+ *       and then the one slot it names
+ * Only the displacements are kept: 16 bits per bucket of about
+ * __perfect_hash_bucket_size keys (~4 bits per key), plus one bit
+ * per slot to skip free slots when iterating, and ~1% free slots.
+ *
+ * Both hashes are hash<Key> (or HashFun) mixed with a seed; if a
+ * seed finds no displacement for some bucket the build restarts
+ * with the next seed.
+ *
+ * Free slots hold a copy of an element stored elsewhere: that key
+ * hashes to its own slot, so it never matches a lookup landing on
+ * the copy, and a miss still costs one comparison.
+ * Keys with equal hash<Key> values can never be told apart by the
+ * hashes; all but one of them go to a small overflow area that is
+ * searched after a mismatch. Duplicate keys are dropped (first kept).
+ */
+
+#ifndef _MY_PERFECT_HASH_MAP_
+#define _MY_PERFECT_HASH_MAP_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include "my_construct.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_vector.h"
+#include "my_int_hash_table.h" // for __int_hash_mix, __int_hash_range
+
+namespace fyj
+{
+
+// Average number of keys per displacement bucket
+static const size_t __perfect_hash_bucket_size = 4;
+// Keys per slot
+static const float __perfect_hash_load = 0.99f;
+// Displacement indexes tried per bucket (they are stored in 16 bits)
+static const size_t __perfect_hash_max_disp = 65536;
+// Seeds tried before the table is given more free slots
+static const size_t __perfect_hash_seeds = 8;
+
+template <class Table>
+struct __perfect_hash_iterator
+{
+	typedef __perfect_hash_iterator<Table> iterator;
+
+	typedef forward_iterator_tag iterator_category;
+	typedef typename Table::value_type value_type;
+	typedef ptrdiff_t difference_type;
+	typedef size_t size_type;
+	typedef const value_type& reference;
+	typedef const value_type* pointer;
+
+	size_type pos;
+	const Table* tab;
+
+	__perfect_hash_iterator(){}
+	__perfect_hash_iterator(size_type p, const Table* t)
+		: pos(p), tab(t) {}
+
+	reference operator*() const {return tab->slots[pos];}
+	pointer operator->() const {return &(operator*());}
+
+	iterator& operator++()
+	{
+		pos = tab->next_used(pos + 1);
+		return *this;
+	}
+
+	iterator operator++(int)
+	{
+		iterator temp = *this;
+		++*this;
+		return temp;
+	}
+
+	bool operator==(const iterator& it) const {return it.pos == pos;}
+	bool operator!=(const iterator& it) const {return it.pos != pos;}
+};
+
+template <class Key,
+		  class T,
+		  class HashFun = hash<Key>,
+		  class EqualKey = equal_to<Key>,
+		  class Alloc = alloc>
+class perfect_hash_map
+{
+public:
+	typedef Key key_type;
+	typedef T data_type;
+	typedef T mapped_type;
+	typedef pair<const Key, T> value_type;
+	typedef HashFun hasher;
+	typedef EqualKey key_equal;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	typedef const value_type& const_reference;
+	typedef const value_type* const_pointer;
+
+	typedef __perfect_hash_iterator<perfect_hash_map> const_iterator;
+	typedef const_iterator iterator;
+	friend struct __perfect_hash_iterator<perfect_hash_map>;
+
+private:
+	typedef simple_alloc<value_type, Alloc> slot_allocator;
+	typedef pair<Key, T> item_type;
+	enum {word_bits = sizeof(unsigned long) * 8};
+
+	hasher hash;
+	key_equal equals;
+
+	size_t seed;
+	size_type num_buckets;
+	size_type num_slots;
+	size_type num_overflow;		// stored after the slots
+	size_type num_elements;
+
+	vector<unsigned short, Alloc> disp;	// per bucket
+	vector<unsigned long, Alloc> used;		// bit per slot
+	value_type* slots;						// num_slots + num_overflow
+
+	size_type bucket_of(size_t h) const
+	{return __int_hash_range(__int_hash_mix(h ^ seed), num_buckets);}
+
+	size_type slot_of(size_t h, size_type k) const
+	{
+		return __int_hash_range(__int_hash_mix((h ^ seed)
+									+ (k + 1) * 0x9e3779b9UL), num_slots);
+	}
+
+	bool is_used(size_type pos) const
+	{return (used.begin()[pos / word_bits] >> (pos % word_bits)) & 1;}
+
+	// First element at or after pos, num_slots + num_overflow is the end
+	size_type next_used(size_type pos) const
+	{
+		while(pos < num_slots && !is_used(pos))
+			++pos;
+		return pos;
+	}
+
+	// Try to place every key with the current seed and num_slots.
+	// slot_pos[i] is set to the slot of items[i], or to
+	// num_slots + j for the j-th overflow item, or to -1 if dropped
+	bool place(const vector<item_type>& items, const vector<size_t>& hs,
+			   vector<size_type>& slot_pos)
+	{
+		const size_type n = items.size();
+		const size_type none = size_type(-1);
+
+		// Group items by bucket (counting sort)
+		vector<size_type> start(num_buckets + 1, size_type(0));
+		vector<size_type> bkt(n, size_type(0));
+		for(size_type i = 0; i < n; ++i)
+		{
+			bkt[i] = bucket_of(hs.begin()[i]);
+			++start[bkt[i] + 1];
+		}
+		size_type max_size = 0;
+		for(size_type b = 0; b < num_buckets; ++b)
+		{
+			if(start[b + 1] > max_size)
+				max_size = start[b + 1];
+			start[b + 1] += start[b];
+		}
+		vector<size_type> members(n, size_type(0));
+		vector<size_type> next(start);
+		for(size_type i = 0; i < n; ++i)
+			members[next[bkt[i]]++] = i;
+
+		// Buckets by decreasing size (counting sort on the size)
+		vector<size_type> size_start(max_size + 2, size_type(0));
+		for(size_type b = 0; b < num_buckets; ++b)
+			++size_start[max_size - (start[b + 1] - start[b]) + 1];
+		for(size_type s = 0; s <= max_size; ++s)
+			size_start[s + 1] += size_start[s];
+		vector<size_type> order(num_buckets, size_type(0));
+		for(size_type b = 0; b < num_buckets; ++b)
+			order[size_start[max_size - (start[b + 1] - start[b])]++] = b;
+
+		vector<unsigned short, Alloc> d(num_buckets, (unsigned short)0);
+		vector<unsigned long, Alloc> u(num_slots / word_bits + 1, 0UL);
+		num_overflow = 0;
+
+		vector<size_type> keep;
+		vector<size_type> spill;	// items of the bucket in the overflow
+		vector<size_type> pos(max_size, size_type(0));
+		for(size_type o = 0; o < num_buckets; ++o)
+		{
+			size_type b = order[o];
+			if(start[b] == start[b + 1])
+				break; // the rest are empty
+
+			// Drop duplicates, send equal hashes to the overflow
+			keep.clear();
+			spill.clear();
+			for(size_type m = start[b]; m < start[b + 1]; ++m)
+			{
+				size_type i = members[m];
+				slot_pos[i] = none;
+				size_type j = 0;
+				for(; j < keep.size(); ++j)
+					if(hs.begin()[keep[j]] == hs.begin()[i])
+						break;
+				if(j == keep.size())
+				{
+					keep.push_back(i);
+					continue;
+				}
+				const key_type& key = items.begin()[i].first;
+				if(equals(items.begin()[keep[j]].first, key))
+					continue;
+				// Nor a key already sent to the overflow
+				size_type l = 0;
+				for(; l < spill.size(); ++l)
+					if(equals(items.begin()[spill[l]].first, key))
+						break;
+				if(l == spill.size())
+				{
+					spill.push_back(i);
+					slot_pos[i] = num_slots + num_overflow++;
+				}
+			}
+
+			size_type k = 0;
+			for(; k < __perfect_hash_max_disp; ++k)
+			{
+				size_type j = 0;
+				for(; j < keep.size(); ++j)
+				{
+					size_type p = slot_of(hs.begin()[keep[j]], k);
+					if((u[p / word_bits] >> (p % word_bits)) & 1)
+						break;
+					size_type l = 0;
+					while(l < j && pos[l] != p)
+						++l;
+					if(l < j)
+						break;
+					pos[j] = p;
+				}
+				if(j == keep.size())
+					break;
+			}
+			if(k == __perfect_hash_max_disp)
+				return false;
+
+			d[b] = (unsigned short)k;
+			for(size_type j = 0; j < keep.size(); ++j)
+			{
+				u[pos[j] / word_bits] |= 1UL << (pos[j] % word_bits);
+				slot_pos[keep[j]] = pos[j];
+			}
+		}
+
+		disp.swap(d);
+		used.swap(u);
+		return true;
+	}
+
+	void build(const vector<item_type>& items)
+	{
+		const size_type n = items.size();
+		if(n == 0)
+			return;
+		vector<size_t> hs(n, size_t(0));
+		for(size_type i = 0; i < n; ++i)
+			hs[i] = hash(items.begin()[i].first);
+
+		num_buckets = n / __perfect_hash_bucket_size + 1;
+		num_slots = size_type(n / __perfect_hash_load) + 1;
+		vector<size_type> slot_pos(n, size_type(0));
+		for(seed = 0; !place(items, hs, slot_pos); ++seed)
+		{
+			if(seed % __perfect_hash_seeds == __perfect_hash_seeds - 1)
+				num_slots += num_slots / 32 + 1;
+		}
+
+		// Fill every slot: elements at their place, a copy of the
+		// first placed element in the free ones
+		size_type filler = 0;
+		while(slot_pos[filler] >= num_slots)
+			++filler;
+		slots = slot_allocator::allocate(num_slots + num_overflow);
+		for(size_type p = 0; p < num_slots; ++p)
+			if(!is_used(p))
+				construct(slots + p, items.begin()[filler]);
+		num_elements = 0;
+		for(size_type i = 0; i < n; ++i)
+		{
+			if(slot_pos[i] == size_type(-1))
+				continue;
+			construct(slots + slot_pos[i], items.begin()[i]);
+			++num_elements;
+		}
+	}
+
+	void destroy_slots()
+	{
+		if(!slots)
+			return;
+		destroy(slots, slots + num_slots + num_overflow);
+		slot_allocator::deallocate(slots, num_slots + num_overflow);
+		slots = 0;
+	}
+
+public:
+	perfect_hash_map()
+		: seed(0), num_buckets(0), num_slots(0), num_overflow(0),
+		  num_elements(0), slots(0) {}
+
+	// Build from a range of pairs with .first / .second,
+	// e.g. the iterators of a map or unordered_map
+	template <class InputIterator>
+	perfect_hash_map(InputIterator first, InputIterator last,
+					 const hasher& hf = hasher(),
+					 const key_equal& keq = key_equal())
+		: hash(hf), equals(keq), seed(0), num_buckets(0), num_slots(0),
+		  num_overflow(0), num_elements(0), slots(0)
+	{
+		vector<item_type> items;
+		for(; first != last; ++first)
+			items.push_back(item_type(first->first, first->second));
+		build(items);
+	}
+
+	perfect_hash_map(const perfect_hash_map& x)
+		: hash(x.hash), equals(x.equals), seed(x.seed),
+		  num_buckets(x.num_buckets), num_slots(x.num_slots),
+		  num_overflow(x.num_overflow), num_elements(x.num_elements),
+		  disp(x.disp), used(x.used), slots(0)
+	{
+		if(!x.slots)
+			return;
+		size_type n = num_slots + num_overflow;
+		slots = slot_allocator::allocate(n);
+		try {
+			uninitialized_copy(x.slots, x.slots + n, slots);
+		}
+		catch(...){
+			slot_allocator::deallocate(slots, n);
+			throw;
+		}
+	}
+
+	perfect_hash_map& operator=(const perfect_hash_map& x)
+	{
+		if(this != &x)
+		{
+			perfect_hash_map temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~perfect_hash_map() {destroy_slots();}
+
+	void swap(perfect_hash_map& x)
+	{
+		fyj::swap(hash, x.hash);
+		fyj::swap(equals, x.equals);
+		fyj::swap(seed, x.seed);
+		fyj::swap(num_buckets, x.num_buckets);
+		fyj::swap(num_slots, x.num_slots);
+		fyj::swap(num_overflow, x.num_overflow);
+		fyj::swap(num_elements, x.num_elements);
+		disp.swap(x.disp);
+		used.swap(x.used);
+		fyj::swap(slots, x.slots);
+	}
+
+	hasher hash_fun() const {return hash;}
+	key_equal key_eq() const {return equals;}
+
+	size_type size() const {return num_elements;}
+	bool empty() const {return num_elements == 0;}
+	size_type bucket_count() const {return num_slots;}
+
+	const_iterator begin() const {return const_iterator(next_used(0), this);}
+	const_iterator end() const
+	{return const_iterator(num_slots + num_overflow, this);}
+
+	const_iterator find(const key_type& key) const
+	{
+		if(num_slots)
+		{
+			size_t h = hash(key);
+			size_type pos = slot_of(h, disp.begin()[bucket_of(h)]);
+			if(equals(slots[pos].first, key))
+				return const_iterator(pos, this);
+		}
+		for(size_type i = num_slots; i < num_slots + num_overflow; ++i)
+			if(equals(slots[i].first, key))
+				return const_iterator(i, this);
+		return end();
+	}
+
+	size_type count(const key_type& key) const
+	{return find(key) == end() ? 0 : 1;}
+
+	// Value of key, which must be present
+	const T& at(const key_type& key) const {return find(key)->second;}
+};
+
+} // end of namespace
+
+#endif
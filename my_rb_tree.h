@@ -6,6 +6,11 @@
  * 		4). number of black node of each path (from root to leaf) must be same
  * By 4) ==> new node must be red; and by 3) ==> parent of new node must be black
  * RB_tree only used for implementation of map and set, not for outside
+ *
+ * Define __RB_TREE_COMPACT (for the whole program) to keep the color in
+ * the low bit of the parent pointer: a node of set<int> takes 32 bytes
+ * instead of 40. Nodes and iterators only touch the two through
+ * parent() / color() and their setters.
  */ 
 
 #ifndef _MY_RB_TREE_
@@ -17,6 +22,9 @@
 #include "my_construct.h" 
 #include "my_uninitialized.h"
 #include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_node_handle.h"
 
 
 namespace fyj
@@ -31,21 +39,55 @@ struct __rb_tree_node_base
 	typedef __rb_tree_color_type color_type;
 	typedef __rb_tree_node_base* base_ptr;
 
-	color_type color;
-	base_ptr parent;
+#ifdef __RB_TREE_COMPACT
+	// The parent pointer with the color in its low bit, free since
+	// nodes are at least pointer aligned: one word less per node
+	size_t parent_color;
+#else
+	color_type color_field;
+	base_ptr parent_field;
+#endif
 	base_ptr left;  //point to left child
 	base_ptr right; //point to right child
 
+#ifdef __RB_TREE_COMPACT
+	base_ptr parent() const {return (base_ptr)(parent_color & ~(size_t)1);}
+	color_type color() const {return (color_type)(parent_color & 1);}
+	void set_parent(base_ptr p)
+	{
+		parent_color = (size_t)p | (parent_color & 1);
+	}
+	void set_color(color_type c)
+	{
+		parent_color = (parent_color & ~(size_t)1) | (size_t)c;
+	}
+	// For a fresh node: writes both, reads nothing
+	void set_parent_color(base_ptr p, color_type c)
+	{
+		parent_color = (size_t)p | (size_t)c;
+	}
+#else
+	base_ptr parent() const {return parent_field;}
+	color_type color() const {return color_field;}
+	void set_parent(base_ptr p) {parent_field = p;}
+	void set_color(color_type c) {color_field = c;}
+	void set_parent_color(base_ptr p, color_type c)
+	{
+		parent_field = p;
+		color_field = c;
+	}
+#endif
+
 	static base_ptr minNode(base_ptr root)
 	{
-		while(root)
+		while(root->left)
 			root = root->left;
 		return root;
 	}
 
 	static base_ptr maxNode(base_ptr root)
 	{
-		while(root)
+		while(root->right)
 			root = root->right;
 		return root;
 	}
@@ -58,6 +100,67 @@ struct __rb_tree_node : public __rb_tree_node_base
 	T value;
 };
 
+// Node of an augmented tree: meta summarizes the subtree of the node
+template <class T, class Meta>
+struct __rb_tree_augmented_node : public __rb_tree_node_base
+{
+	typedef __rb_tree_augmented_node<T, Meta>* link_type;
+	T value;
+	Meta meta;
+};
+
+/* Augment policies: a summary of each subtree kept in its root node,
+ * e.g. its size (rank_augment) or the largest interval end (see
+ * "my_interval_map.h"). User policies work the same way.
+ * A policy has a meta_type (default constructible), stored in every
+ * node, and
+ *     template <class Node> static void update(Node* x)
+ * which recomputes x->meta from x->value and the meta of x's children
+ * (null children have none). The tree calls it bottom-up wherever a
+ * subtree changes: after a link or an unlink, in each rotation, and
+ * when it builds nodes. Queries walk the nodes from root_node().
+ * A node handle dropped while it owns a node destroys meta too.
+ */
+
+// The default: plain nodes, nothing to update
+struct no_augment
+{
+	template <class Node>
+	static void update(Node*) {}
+};
+
+// Subtree sizes, for select / rank / distance in O(log n)
+struct rank_augment
+{
+	typedef size_t meta_type;
+
+	template <class Node>
+	static size_t size(__rb_tree_node_base* x)
+	{
+		return x ? static_cast<Node*>(x)->meta : 0;
+	}
+
+	template <class Node>
+	static void update(Node* x)
+	{
+		x->meta = 1 + size<Node>(x->left) + size<Node>(x->right);
+	}
+};
+
+template <class T, class Augment>
+struct __rb_tree_node_type
+{
+	typedef __rb_tree_augmented_node<T, typename Augment::meta_type> type;
+	enum {augmented = true};
+};
+
+template <class T>
+struct __rb_tree_node_type<T, no_augment>
+{
+	typedef __rb_tree_node<T> type;
+	enum {augmented = false};
+};
+
 struct __rb_tree_iterator_base
 {
 	typedef __rb_tree_node_base::base_ptr base_ptr;
@@ -81,11 +184,11 @@ struct __rb_tree_iterator_base
 		// Case 2: right sub-tree is null
 		else
 		{
-			base_ptr p = node->parent;
+			base_ptr p = node->parent();
 			while(node == p->right)
 			{
 				node = p;
-				p = p->parent;
+				p = p->parent();
 			}
 			if(node->right != p)
 				node = p;
@@ -97,8 +200,8 @@ struct __rb_tree_iterator_base
 	void decrement()
 	{
 		// Case 1: the node is the head of the tree
-		if (node->color == __rb_tree_red && 
-			node->parent->parent == node)
+		if (node->color() == __rb_tree_red && 
+			node->parent()->parent() == node)
 			node = node->right;
 		// Case 2: the node has left child
 		else if (node->left)
@@ -111,27 +214,28 @@ struct __rb_tree_iterator_base
 		// Case 3
 		else
 		{
-			base_ptr p = p->parent;
+			base_ptr p = node->parent();
 			while(node == p->left)
 			{
 				node = p;
-				p = p->parent;
+				p = p->parent();
 			}
 			node = p;
 		}
 	}
 };
 
-template <class T, class Ref,class Pointer>
+// Node: the node type of the tree, which holds T in "value"
+template <class T, class Ref,class Pointer, class Node = __rb_tree_node<T> >
 struct __rb_tree_iterator : public __rb_tree_iterator_base
 {
 	typedef T 					value_type;
 	typedef Ref   				reference;
 	typedef Pointer 		  	pointer;
-	typedef __rb_tree_iterator<T, T&, T*>  iterator;
-	typedef __rb_tree_iterator<const T, const T&, const T*>  const_iterator;
-	typedef __rb_tree_iterator<T, Ref, Pointer> self;
-	typedef __rb_tree_node<T>* link_type;
+	typedef __rb_tree_iterator<T, T&, T*, Node>  iterator;
+	typedef __rb_tree_iterator<T, const T&, const T*, Node>  const_iterator;
+	typedef __rb_tree_iterator<T, Ref, Pointer, Node> self;
+	typedef Node* link_type;
 
 	__rb_tree_iterator(){}
 	__rb_tree_iterator(link_type x) {node = x;}
@@ -166,16 +270,29 @@ struct __rb_tree_iterator : public __rb_tree_iterator_base
 
 };
 
+inline bool operator==(const __rb_tree_iterator_base& x,
+					   const __rb_tree_iterator_base& y)
+{
+	return x.node == y.node;
+}
+
+inline bool operator!=(const __rb_tree_iterator_base& x,
+					   const __rb_tree_iterator_base& y)
+{
+	return x.node != y.node;
+}
+
 // Each node of RB_tree has a Key-Value pair
 // The tree is ordered by Key, which is determined by Compare
+// Augment: extra data kept per node, see rank_augment
 template <class Key, class Value, class KeyOfValue, class Compare,
-		  class Alloc = alloc>
+		  class Alloc = alloc, class Augment = no_augment>
 class rb_tree
 {
 protected:
 	typedef void* 					  		  void_pointer;
 	typedef __rb_tree_node_base*  			  base_ptr;
-	typedef __rb_tree_node<Value> 			  rb_tree_node;
+	typedef typename __rb_tree_node_type<Value, Augment>::type rb_tree_node;
 	typedef simple_alloc<rb_tree_node, Alloc> rb_tree_node_allocator;
 	typedef __rb_tree_color_type   			  color_type;
 
@@ -192,27 +309,60 @@ public:
 
 protected:
 	link_type get_node() { return rb_tree_node_allocator::allocate(); }
-	void put_node(link_type p){ rb_tree_node_allocator::deallocate(p);}
+	static void put_node(link_type p){ rb_tree_node_allocator::deallocate(p);}
 
 	link_type create_node(const value_type& x)
 	{
 		link_type temp = get_node();
-		construct(&temp->value, x);
+		try {
+			construct(&temp->value, x);
+		}
+		catch(...){
+			put_node(temp);
+			throw;
+		}
+		construct_meta(temp);
 		return temp;
 	}
 
+	// Same structure, same summaries: meta is copied, not recomputed
 	link_type clone_node(link_type x)
 	{
 		link_type temp = create_node(x->value);
-		temp->color = x->color;
+		temp->set_parent_color(0, x->color());
 		temp->left = 0;
 		temp->right = 0;
+		copy_meta(temp, x);
 		return temp;
 	}
 
-	void destroy_node(link_type p)
+	// Plain nodes have no meta
+	static void construct_meta(__rb_tree_node<Value>*) {}
+	static void destroy_meta(__rb_tree_node<Value>*) {}
+	static void copy_meta(__rb_tree_node<Value>*, __rb_tree_node<Value>*) {}
+
+	template <class Meta>
+	static void construct_meta(__rb_tree_augmented_node<Value, Meta>* x)
+	{
+		construct(&x->meta, Meta());
+	}
+	template <class Meta>
+	static void destroy_meta(__rb_tree_augmented_node<Value, Meta>* x)
+	{
+		destroy(&x->meta);
+	}
+	template <class Meta>
+	static void copy_meta(__rb_tree_augmented_node<Value, Meta>* to,
+						  __rb_tree_augmented_node<Value, Meta>* from)
+	{
+		to->meta = from->meta;
+	}
+
+	// Static: node_type calls it on the node of a dropped handle
+	static void destroy_node(link_type p)
 	{
 		destroy(&p->value);
+		destroy_meta(p);
 		put_node(p);
 	}
 
@@ -226,25 +376,44 @@ protected:
 	link_type header;
 	Compare key_compare;
 
-	link_type& root() const {return (link_type&)header->parent;}
+	link_type root() const {return (link_type)header->parent();}
+	void set_root(base_ptr x) {header->set_parent(x);}
 	link_type& leftmost() const {return (link_type&)header->left;}
 	link_type& rightmost() const {return (link_type&)header->right;}
 
 	static link_type& left(link_type x){return (link_type&)(x->left);}
 	static link_type& right(link_type x){return (link_type&)(x->right);}
-	static link_type& parent(link_type x){return (link_type&)(x->parent);}
+	static link_type parent(link_type x){return (link_type)x->parent();}
 	static reference value(link_type x){return x->value;}
 	static const Key& key(link_type x){return KeyOfValue()(value(x));}
-	static color_type& color(link_type x){return (color_type&)(x->color);}
+	static color_type color(link_type x){return x->color();}
 
 	// base_ptr = __rb_tree_node_base*
 	// link_ptr = __rb_tree_node*
 	static link_type& left(base_ptr x){return (link_type&)(x->left);}
 	static link_type& right(base_ptr x){return (link_type&)(x->right);}
-	static link_type& parent(base_ptr x){return (link_type&)(x->parent);}
+	static link_type parent(base_ptr x){return (link_type)x->parent();}
 	static reference value(base_ptr x){return ((link_type)x)->value;}
 	static const Key& key(base_ptr x){return KeyOfValue()(value(x));}
-	static color_type& color(base_ptr x){return (color_type&)(x->color);}
+	static color_type color(base_ptr x){return x->color();}
+
+	enum {augmented = __rb_tree_node_type<Value, Augment>::augmented};
+
+	static size_type subtree_size(base_ptr x)
+	{
+		return Augment::template size<rb_tree_node>(x);
+	}
+
+	// Recompute the summary of x from its children
+	static void update(base_ptr x) {Augment::update((link_type)x);}
+
+	// ... and of its ancestors, after x's subtree changed
+	void update_path(base_ptr x)
+	{
+		if(augmented)
+			for(; x != header; x = x->parent())
+				update(x);
+	}
 
 	static link_type minNode(link_type x)
 	{
@@ -256,7 +425,14 @@ protected:
 	}
 
 public:
-	typedef __rb_tree_iterator<value_type, reference, pointer> iterator;
+	typedef __rb_tree_iterator<value_type, reference, pointer,
+							   rb_tree_node> iterator;
+	typedef __rb_tree_iterator<value_type, const_reference, const_pointer,
+							   rb_tree_node> const_iterator;
+	typedef fyj::reverse_iterator<iterator> reverse_iterator;
+	typedef fyj::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef __node_handle<rb_tree_node, value_type, &rb_tree_node::value,
+						  Alloc, &rb_tree::destroy_node> node_type;
 
 private:
 	// left rotate
@@ -265,17 +441,20 @@ private:
 		base_ptr y = x->right;
 		x->right = y->left;
 		if(y->left)
-			y->left->parent = x;
-		y->parent = x->parent;
+			y->left->set_parent(x);
+		y->set_parent(x->parent());
 
 		if(x == root)
 			root = y;
-		else if(x == x->parent->left)
-			x->parent->left = y;
+		else if(x == x->parent()->left)
+			x->parent()->left = y;
 		else
-			x->parent->right = y;
+			x->parent()->right = y;
 		y->left = x;
-		x->parent = y;
+		x->set_parent(y);
+		// x is now below y
+		update(x);
+		update(y);
 	}
 
 	// right rotate
@@ -284,17 +463,19 @@ private:
 		base_ptr y = x->left;
 		x->left = y->right;
 		if(y->right)
-			y->right->parent = x;
-		y->parent = x->parent;
+			y->right->set_parent(x);
+		y->set_parent(x->parent());
 
 		if(x == root)
 			root = y;
-		else if(x == x->parent->right)
-			x->parent->right = y;
+		else if(x == x->parent()->right)
+			x->parent()->right = y;
 		else
-			x->parent->left = y;
+			x->parent()->left = y;
 		y->right = x;
-		x->parent = y;
+		x->set_parent(y);
+		update(x);
+		update(y);
 	}
 
 
@@ -303,81 +484,248 @@ private:
 	void __rb_tree_rebalance(base_ptr x, base_ptr& root)
 	{
 		// new node x must be red
-		x->color = __rb_tree_red;
+		x->set_color(__rb_tree_red);
 
 		// parent of new node x must be black
-		while(x != root && x->parent->color == __rb_tree_red)
+		while(x != root && x->parent()->color() == __rb_tree_red)
 		{
-			if(x->parent == x->parent->parent->left)
+			if(x->parent() == x->parent()->parent()->left)
 			{
 				// y is uncle of x
-				base_ptr y = x->parent->parent->right;
-				if(y && y->color == __rb_tree_red)
+				base_ptr y = x->parent()->parent()->right;
+				if(y && y->color() == __rb_tree_red)
 				{
 					// parent and uncle must both be black
-					x->parent->color = __rb_tree_black;
-					y->color = __rb_tree_black;
+					x->parent()->set_color(__rb_tree_black);
+					y->set_color(__rb_tree_black);
 					// then grand parent should be red
-					x->parent->parent->color = __rb_tree_red;
-					x = x->parent->parent;
+					x->parent()->parent()->set_color(__rb_tree_red);
+					x = x->parent()->parent();
 				}
 				else
 				{
-					if(x == x->parent->right)
+					if(x == x->parent()->right)
 					{
-						x = x->parent;
+						x = x->parent();
 						__rb_tree_rotate_left(x, root);
 					}
-					x->parent->color = __rb_tree_black;
-					x->parent->parent->color = __rb_tree_red;
-					__rb_tree_rotate_right(x->parent->parent, root);
+					x->parent()->set_color(__rb_tree_black);
+					x->parent()->parent()->set_color(__rb_tree_red);
+					__rb_tree_rotate_right(x->parent()->parent(), root);
 				}
 			}
 			else
 			{
 				// y is uncle of x
-				base_ptr y = x->parent->parent->left;
-				if(y && y->color == __rb_tree_red)
+				base_ptr y = x->parent()->parent()->left;
+				if(y && y->color() == __rb_tree_red)
 				{
 					// parent and uncle must both be black
-					x->parent->color = __rb_tree_black;
-					y->color = __rb_tree_black;
+					x->parent()->set_color(__rb_tree_black);
+					y->set_color(__rb_tree_black);
 					// then grand parent should be red
-					x->parent->parent->color = __rb_tree_red;
-					x = x->parent->parent;
+					x->parent()->parent()->set_color(__rb_tree_red);
+					x = x->parent()->parent();
 				}
 				else
 				{
-					if(x == x->parent->left)
+					if(x == x->parent()->left)
 					{
-						x = x->parent;
+						x = x->parent();
 						__rb_tree_rotate_right(x, root);
 					}
-					x->parent->color = __rb_tree_black;
-					x->parent->parent->color = __rb_tree_red;
-					__rb_tree_rotate_left(x->parent->parent, root);
+					x->parent()->set_color(__rb_tree_black);
+					x->parent()->parent()->set_color(__rb_tree_red);
+					__rb_tree_rotate_left(x->parent()->parent(), root);
+				}
+			}
+		}
+		root->set_color(__rb_tree_black);
+	}
+
+	// Unlink z from the tree and rebalance
+	// Used when erase / extract node z
+	// If z has two children, its successor y takes z's place (and 
+	// color) in the tree, so the node that leaves is always z itself
+	base_ptr __rb_tree_rebalance_for_erase(base_ptr z, base_ptr& root,
+										   base_ptr& leftmost,
+										   base_ptr& rightmost)
+	{
+		base_ptr y = z;
+		base_ptr x = 0;         // the child that moves up
+		base_ptr x_parent = 0;
+
+		if(!y->left)            // z has at most one child: y = z
+			x = y->right;
+		else if(!y->right)      // z has only a left child: y = z
+			x = y->left;
+		else                    // two children: y = successor of z
+		{
+			y = y->right;
+			while(y->left)
+				y = y->left;
+			x = y->right;
+		}
+
+		if(y != z)
+		{
+			// relink y in place of z
+			z->left->set_parent(y);
+			y->left = z->left;
+			if(y != z->right)
+			{
+				x_parent = y->parent();
+				if(x)
+					x->set_parent(y->parent());
+				y->parent()->left = x; // y must be a left child
+				y->right = z->right;
+				z->right->set_parent(y);
+			}
+			else
+				x_parent = y;
+
+			if(root == z)
+				root = y;
+			else if(z->parent()->left == z)
+				z->parent()->left = y;
+			else
+				z->parent()->right = y;
+			y->set_parent(z->parent());
+			color_type c = y->color();
+			y->set_color(z->color());
+			z->set_color(c);
+			y = z;              // y is now the node that leaves
+		}
+		else
+		{
+			x_parent = y->parent();
+			if(x)
+				x->set_parent(y->parent());
+			if(root == z)
+				root = x;
+			else if(z->parent()->left == z)
+				z->parent()->left = x;
+			else
+				z->parent()->right = x;
+
+			// header is parent of root, so leftmost / rightmost fall
+			// back to header when the tree becomes empty
+			if(leftmost == z)
+				leftmost = z->right ? __rb_tree_node_base::minNode(x)
+									: z->parent();
+			if(rightmost == z)
+				rightmost = z->left ? __rb_tree_node_base::maxNode(x)
+									: z->parent();
+		}
+
+		// the subtrees from the unlink point up have lost a node; the
+		// rotations below keep the summaries they touch right
+		update_path(x_parent);
+
+		// a black node left: the path through x is short of one black
+		if(y->color() != __rb_tree_red)
+		{
+			while(x != root && (!x || x->color() == __rb_tree_black))
+			{
+				if(x == x_parent->left)
+				{
+					// w is sibling of x
+					base_ptr w = x_parent->right;
+					if(w->color() == __rb_tree_red)
+					{
+						w->set_color(__rb_tree_black);
+						x_parent->set_color(__rb_tree_red);
+						__rb_tree_rotate_left(x_parent, root);
+						w = x_parent->right;
+					}
+					if((!w->left || w->left->color() == __rb_tree_black) &&
+					   (!w->right || w->right->color() == __rb_tree_black))
+					{
+						w->set_color(__rb_tree_red);
+						x = x_parent;
+						x_parent = x_parent->parent();
+					}
+					else
+					{
+						if(!w->right || w->right->color() == __rb_tree_black)
+						{
+							if(w->left)
+								w->left->set_color(__rb_tree_black);
+							w->set_color(__rb_tree_red);
+							__rb_tree_rotate_right(w, root);
+							w = x_parent->right;
+						}
+						w->set_color(x_parent->color());
+						x_parent->set_color(__rb_tree_black);
+						if(w->right)
+							w->right->set_color(__rb_tree_black);
+						__rb_tree_rotate_left(x_parent, root);
+						break;
+					}
+				}
+				else
+				{
+					// same as above with left <-> right
+					base_ptr w = x_parent->left;
+					if(w->color() == __rb_tree_red)
+					{
+						w->set_color(__rb_tree_black);
+						x_parent->set_color(__rb_tree_red);
+						__rb_tree_rotate_right(x_parent, root);
+						w = x_parent->left;
+					}
+					if((!w->right || w->right->color() == __rb_tree_black) &&
+					   (!w->left || w->left->color() == __rb_tree_black))
+					{
+						w->set_color(__rb_tree_red);
+						x = x_parent;
+						x_parent = x_parent->parent();
+					}
+					else
+					{
+						if(!w->left || w->left->color() == __rb_tree_black)
+						{
+							if(w->right)
+								w->right->set_color(__rb_tree_black);
+							w->set_color(__rb_tree_red);
+							__rb_tree_rotate_left(w, root);
+							w = x_parent->left;
+						}
+						w->set_color(x_parent->color());
+						x_parent->set_color(__rb_tree_black);
+						if(w->left)
+							w->left->set_color(__rb_tree_black);
+						__rb_tree_rotate_right(x_parent, root);
+						break;
+					}
 				}
 			}
+			if(x)
+				x->set_color(__rb_tree_black);
 		}
-		root->color = __rb_tree_black;
+		return y;
 	}
 
 	// insert the node with value v, to the place of x ...
 	//        ... whose parent is y
 	// Used for insert_unique and insert_equal
 	iterator __insert(base_ptr x_, base_ptr y_, const value_type& v)
+	{
+		return __insert_node(x_, y_, create_node(v));
+	}
+
+	// Link the ready-made node z, used by __insert and node handles
+	iterator __insert_node(base_ptr x_, base_ptr y_, link_type z)
 	{
 		link_type x = (link_type)x_;
 		link_type y = (link_type)y_;
-		link_type z;
-		z = create_node(v);
 
-		if(y == header || x || key_compare(KeyOfValue()(v),key(y)))
+		if(y == header || x || key_compare(key(z),key(y)))
 		{
 			left(y) = z; // leftmost is z
 			if(y == header)
 			{
-				root() = z;
+				set_root(z);
 				rightmost() = z;
 			}
 			else if(y == leftmost())
@@ -390,11 +738,15 @@ private:
 				rightmost() = z;
 		}
 
-		parent(z) = y;
+		z->set_parent_color(y, __rb_tree_red);
 		left(z) = 0;
 		right(z) = 0;
+		update(z);
+		update_path(y);
 
-		__rb_tree_rebalance(z, header->parent);
+		base_ptr r = root();
+		__rb_tree_rebalance(z, r);
+		set_root(r);
 		++node_count;
 		return iterator(z);
 	}
@@ -403,11 +755,119 @@ private:
 
 	void __erase(link_type x);
 
+	template <class InputIterator>
+	void __insert_range(InputIterator first, InputIterator last,
+						bool unique, input_iterator_tag)
+	{
+		for(; first != last; ++first)
+		{
+			if(unique)
+				insert_unique(end(), *first);
+			else
+				insert_equal(end(), *first);
+		}
+	}
+
+	// Forward iterators can be read twice: check the order, then build
+	template <class ForwardIterator>
+	void __insert_range(ForwardIterator first, ForwardIterator last,
+						bool unique, forward_iterator_tag)
+	{
+		if(empty() && __sorted(first, last, unique))
+		{
+			size_type n = fyj::distance(first, last);
+			if(!n)
+				return;
+			// levels 0 .. h-1 are full, the nodes of level h are red
+			int h = 0;
+			for(size_type m = n + 1; m > 1; m >>= 1)
+				++h;
+			link_type x = __build(first, n, 0, h);
+			x->set_parent(header);
+			set_root(x);
+			leftmost() = minNode(root());
+			rightmost() = maxNode(root());
+			node_count = n;
+		}
+		else
+			__insert_range(first, last, unique, input_iterator_tag());
+	}
+
+	// Ascending order (strictly if unique)
+	template <class ForwardIterator>
+	bool __sorted(ForwardIterator first, ForwardIterator last,
+				  bool unique) const
+	{
+		if(first == last)
+			return true;
+		ForwardIterator next = first;
+		for(++next; next != last; ++first, ++next)
+		{
+			const Key& a = KeyOfValue()(*first);
+			const Key& b = KeyOfValue()(*next);
+			if(unique ? !key_compare(a, b) : key_compare(b, a))
+				return false;
+		}
+		return true;
+	}
+
+	// Perfectly balanced subtree of the next n values of first, which
+	// is advanced past them. Nodes are created in order, in one sweep.
+	// The sizes of two siblings differ by at most one, so all the
+	// levels above the last are full: coloring the last level
+	// (red_depth) red and the rest black gives a valid rb_tree
+	template <class ForwardIterator>
+	link_type __build(ForwardIterator& first, size_type n, int depth,
+					  int red_depth)
+	{
+		if(!n)
+			return 0;
+		const size_type nl = (n - 1) / 2;
+		link_type l = __build(first, nl, depth + 1, red_depth);
+		link_type x;
+		try {
+			x = create_node(*first);
+		}
+		catch(...){
+			__erase(l);
+			throw;
+		}
+		++first;
+		x->set_parent_color(0, depth == red_depth ? __rb_tree_red
+												  : __rb_tree_black);
+		left(x) = l;
+		right(x) = 0;
+		if(l)
+			l->set_parent(x);
+		try {
+			right(x) = __build(first, n - 1 - nl, depth + 1, red_depth);
+		}
+		catch(...){
+			__erase(x);
+			throw;
+		}
+		if(right(x))
+			right(x)->set_parent(x);
+		update(x);
+		return x;
+	}
+
+	// Copy the nodes of x into this empty tree
+	void copy_from(const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& x)
+	{
+		if(x.root())
+		{
+			set_root(__copy(x.root(), header));
+			leftmost() = minNode(root());
+			rightmost() = maxNode(root());
+		}
+		node_count = x.node_count;
+	}
+
 	void init()
 	{
 		header = get_node();
-		color(header) = __rb_tree_red;
-		root() = 0;
+		header->set_parent_color(0, __rb_tree_red);
 		leftmost() = header;
 		rightmost() = header;
 	}
@@ -415,25 +875,459 @@ private:
 public:
 	rb_tree(const Compare& comp = Compare())
 		: node_count(0), key_compare(comp) {init();}
-	// ~rb_tree()
-	// {
-	// 	clear();
-	// 	put_node(header);
-	// }
-	rb_tree<Key, Value, KeyOfValue, Compare, Alloc>&
-		operator=(const rb_tree<Key, Value, KeyOfValue, Compare, Alloc>& x);
-
-	Compare key_com() const {return key_compare;}
+
+	rb_tree(const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& x)
+		: node_count(0), key_compare(x.key_compare)
+	{
+		init();
+		try {
+			copy_from(x);
+		}
+		catch(...){
+			put_node(header);
+			throw;
+		}
+	}
+
+	~rb_tree()
+	{
+		clear();
+		put_node(header);
+	}
+
+	rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>&
+		operator=(const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& x);
+
+	Compare key_comp() const {return key_compare;}
 	iterator begin() const {return leftmost();}
 	iterator end() const {return header;}
+	reverse_iterator rbegin() const {return reverse_iterator(end());}
+	reverse_iterator rend() const {return reverse_iterator(begin());}
 	bool empty() const {return node_count == 0;}
 	size_type size() const {return node_count;}
 	size_type max_size() const {return size_type(-1);}
-	void swap();
+
+	// The header holds the whole tree: swapping it swaps the trees
+	void swap(rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& t)
+	{
+		fyj::swap(header, t.header);
+		fyj::swap(node_count, t.node_count);
+		fyj::swap(key_compare, t.key_compare);
+	}
 
 	// insert so that any node is unique
 	// used for map / set
 	pair<iterator, bool> insert_unique(const value_type& v)
+	{
+		pair<link_type, bool> p = __insert_unique_pos(KeyOfValue()(v));
+		if(p.second)
+			return pair<iterator, bool>(__insert(0, p.first, v), true);
+		return pair<iterator, bool>(iterator(p.first), false);
+	}
+
+	// insert and allow duplicate node
+	// used for multimap / multiset
+	iterator insert_equal(const value_type& v)
+	{
+		return __insert(0, __insert_equal_pos(KeyOfValue()(v)), v);
+	}
+
+	// Hinted insert: v goes right before position if it belongs there,
+	// without descending from the root (amortized O(1)); otherwise
+	// same as insert_unique(v)
+	iterator insert_unique(iterator position, const value_type& v)
+	{
+		const Key& k = KeyOfValue()(v);
+		if(position.node == header->left)    // begin()
+		{
+			if(node_count && key_compare(k, key(position.node)))
+				return __insert(position.node, position.node, v);
+		}
+		else if(position.node == header)     // end()
+		{
+			if(key_compare(key(rightmost()), k))
+				return __insert(0, rightmost(), v);
+		}
+		else
+		{
+			iterator before = position;
+			--before;
+			if(key_compare(key(before.node), k) &&
+			   key_compare(k, key(position.node)))
+			{
+				// the new node is right child of before or...
+				// ...left child of position, whichever is free
+				if(!before.node->right)
+					return __insert(0, before.node, v);
+				return __insert(position.node, position.node, v);
+			}
+		}
+		return insert_unique(v).first;
+	}
+
+	iterator insert_equal(iterator position, const value_type& v)
+	{
+		const Key& k = KeyOfValue()(v);
+		if(position.node == header->left)    // begin()
+		{
+			if(node_count && !key_compare(key(position.node), k))
+				return __insert(position.node, position.node, v);
+		}
+		else if(position.node == header)     // end()
+		{
+			if(!key_compare(k, key(rightmost())))
+				return __insert(0, rightmost(), v);
+		}
+		else
+		{
+			iterator before = position;
+			--before;
+			if(!key_compare(k, key(before.node)) &&
+			   !key_compare(key(position.node), k))
+			{
+				if(!before.node->right)
+					return __insert(0, before.node, v);
+				return __insert(position.node, position.node, v);
+			}
+		}
+		return insert_equal(v);
+	}
+
+	// Sorted ranges into an empty tree are built in O(n), see __build;
+	// otherwise each value is inserted with end() as hint, so a
+	// sorted stream still appends in amortized O(1)
+	template <class InputIterator>
+	void insert_unique(InputIterator first, InputIterator last)
+	{
+		__insert_range(first, last, true, iterator_category(first));
+	}
+
+	template <class InputIterator>
+	void insert_equal(InputIterator first, InputIterator last)
+	{
+		__insert_range(first, last, false, iterator_category(first));
+	}
+
+	//================ ERASE ===================================
+	// Unlink pos, rebalance and free its node
+	// Returns the iterator after pos: O(1) amortized
+	iterator erase(iterator pos)
+	{
+		iterator next = pos;
+		++next;
+		base_ptr r = root();
+		link_type y = (link_type)__rb_tree_rebalance_for_erase(pos.node, r,
+															  header->left,
+															  header->right);
+		set_root(r);
+		destroy_node(y);
+		--node_count;
+		return next;
+	}
+
+	// Erase all the nodes with key k, return how many
+	size_type erase(const Key& k)
+	{
+		size_type n = 0;
+		// find gives the first of the equal keys
+		for(iterator it = find(k);
+			it != end() && !key_compare(k, key(it.node)); ++n)
+			it = erase(it);
+		return n;
+	}
+
+	iterator erase(iterator first, iterator last)
+	{
+		if(first == begin() && last == end())
+		{
+			clear();
+			return end();
+		}
+		while(first != last)
+			first = erase(first);
+		return last;
+	}
+
+	void clear()
+	{
+		if(node_count)
+		{
+			__erase(root());
+			set_root(0);
+			leftmost() = header;
+			rightmost() = header;
+			node_count = 0;
+		}
+	}
+
+	// Root of the tree, 0 if empty: the entry point of the queries
+	// on an augmented tree (iterator(x) gives the value of node x)
+	link_type root_node() const {return root();}
+
+	//================ ORDER STATISTICS ========================
+	// Only with Augment = rank_augment: O(log n) each
+
+	// The value at position k (from 0) in order; end() if k >= size()
+	iterator select(size_type k) const
+	{
+		link_type x = root();
+		while(x)
+		{
+			size_type l = subtree_size(x->left);
+			if(k < l)
+				x = left(x);
+			else if(k == l)
+				return iterator(x);
+			else
+			{
+				k -= l + 1;
+				x = right(x);
+			}
+		}
+		return end();
+	}
+
+	// Number of values whose key is less than k
+	size_type rank(const Key& k) const
+	{
+		size_type r = 0;
+		for(link_type x = root(); x; )
+		{
+			if(key_compare(key(x), k))
+			{
+				r += subtree_size(x->left) + 1;
+				x = right(x);
+			}
+			else
+				x = left(x);
+		}
+		return r;
+	}
+
+	// Position of it in order; size() for end()
+	size_type index(const_iterator it) const
+	{
+		if(it.node == header)
+			return node_count;
+		base_ptr x = it.node;
+		size_type r = subtree_size(x->left);
+		for(; x != root(); x = x->parent())
+			if(x == x->parent()->right)
+				r += subtree_size(x->parent()->left) + 1;
+		return r;
+	}
+
+	difference_type distance(const_iterator first, const_iterator last) const
+	{
+		return difference_type(index(last)) - difference_type(index(first));
+	}
+
+	//================ EXTRACT & MERGE =========================
+	// Take a node out of the tree, without freeing it
+	node_type extract(iterator pos)
+	{
+		base_ptr r = root();
+		base_ptr z = __rb_tree_rebalance_for_erase(pos.node, r,
+												   header->left,
+												   header->right);
+		set_root(r);
+		--node_count;
+		return node_type((link_type)z);
+	}
+
+	// An empty handle if k is missing
+	node_type extract(const Key& k)
+	{
+		iterator it = find(k);
+		if(it == end())
+			return node_type();
+		return extract(it);
+	}
+
+	// Link the node owned by nh; nh is emptied on success
+	// If the key already exists, nh keeps its node
+	pair<iterator, bool> insert_unique(node_type& nh)
+	{
+		if(nh.empty())
+			return pair<iterator, bool>(end(), false);
+		pair<link_type, bool> p = 
+			__insert_unique_pos(KeyOfValue()(nh.value()));
+		if(p.second)
+			return pair<iterator, bool>(
+				__insert_node(0, p.first, nh.release()), true);
+		return pair<iterator, bool>(iterator(p.first), false);
+	}
+
+	iterator insert_equal(node_type& nh)
+	{
+		if(nh.empty())
+			return end();
+		// The position first: release() empties nh
+		link_type y = __insert_equal_pos(KeyOfValue()(nh.value()));
+		return __insert_node(0, y, nh.release());
+	}
+
+	// Relink into this tree every node of t whose key is not here
+	// yet; the others stay in t. Nothing is allocated or copied
+	void merge_unique(rb_tree& t)
+	{
+		if(&t == this)
+			return;
+		for(iterator it = t.begin(); it != t.end();)
+		{
+			iterator next = it;
+			++next;
+			pair<link_type, bool> p = __insert_unique_pos(key(it.node));
+			if(p.second)
+			{
+				node_type nh = t.extract(it);
+				__insert_node(0, p.first, nh.release());
+			}
+			it = next;
+		}
+	}
+
+	// Relink every node of t into this tree
+	void merge_equal(rb_tree& t)
+	{
+		if(&t == this)
+			return;
+		for(iterator it = t.begin(); it != t.end();)
+		{
+			iterator next = it;
+			++next;
+			link_type y = __insert_equal_pos(key(it.node));
+			node_type nh = t.extract(it);
+			__insert_node(0, y, nh.release());
+			it = next;
+		}
+	}
+
+	// find
+	iterator find(const Key& k) const {return __find(k);}
+
+	// Transparent find: k may be any type Compare can order against Key
+	// Only when Compare has "is_transparent", see "my_functors.h"
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	find(const K& k) const {return __find(k);}
+
+	//================ RANGE QUERIES ===========================
+	// First value whose key is not less than k
+	iterator lower_bound(const Key& k) const
+	{return __lower_bound(root(), header, k);}
+
+	// First value whose key is greater than k
+	iterator upper_bound(const Key& k) const
+	{return __upper_bound(root(), header, k);}
+
+	pair<iterator, iterator> equal_range(const Key& k) const
+	{return __equal_range(k);}
+
+	// Transparent versions, see find
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	lower_bound(const K& k) const {return __lower_bound(root(), header, k);}
+
+	template <class K>
+	typename __if_transparent<K, iterator, Compare>::type
+	upper_bound(const K& k) const {return __upper_bound(root(), header, k);}
+
+	template <class K>
+	typename __if_transparent<K, pair<iterator, iterator>, Compare>::type
+	equal_range(const K& k) const {return __equal_range(k);}
+
+	// One descent for the bounds; the equal values are then counted
+	// from the subtree sizes with rank_augment, else walked
+	size_type count(const Key& k) const
+	{
+		pair<iterator, iterator> p = __equal_range(k);
+		return __range_size(p.first, p.second, (Augment*)0);
+	}
+
+	template <class K>
+	typename __if_transparent<K, size_type, Compare>::type
+	count(const K& k) const
+	{
+		pair<iterator, iterator> p = __equal_range(k);
+		return __range_size(p.first, p.second, (Augment*)0);
+	}
+
+protected:
+	size_type __range_size(iterator first, iterator last, rank_augment*) const
+	{
+		return index(last) - index(first);
+	}
+
+	template <class A>
+	size_type __range_size(iterator first, iterator last, A*) const
+	{
+		size_type n = 0;
+		for(; first != last; ++first)
+			++n;
+		return n;
+	}
+
+	// Bounds in the subtree x; y is the answer if nothing in x is
+	template <class K>
+	iterator __lower_bound(link_type x, link_type y, const K& k) const
+	{
+		while(x)
+		{
+			if(!key_compare(key(x), k))
+			{
+				y = x;
+				x = left(x);
+			}
+			else
+				x = right(x);
+		}
+		return iterator(y);
+	}
+
+	template <class K>
+	iterator __upper_bound(link_type x, link_type y, const K& k) const
+	{
+		while(x)
+		{
+			if(key_compare(k, key(x)))
+			{
+				y = x;
+				x = left(x);
+			}
+			else
+				x = right(x);
+		}
+		return iterator(y);
+	}
+
+	// Descend to the first node equal to k, then the lower bound is
+	// in its left subtree and the upper bound in its right subtree
+	template <class K>
+	pair<iterator, iterator> __equal_range(const K& k) const
+	{
+		link_type y = header;
+		link_type x = root();
+		while(x)
+		{
+			if(key_compare(key(x), k))
+				x = right(x);
+			else if(key_compare(k, key(x)))
+			{
+				y = x;
+				x = left(x);
+			}
+			else
+				return pair<iterator, iterator>(
+					__lower_bound(left(x), x, k),
+					__upper_bound(right(x), y, k));
+		}
+		return pair<iterator, iterator>(iterator(y), iterator(y));
+	}
+
+	// Parent y under which a unique key k is to be inserted: (y, true)
+	// Or the node already holding k: (node, false)
+	pair<link_type, bool> __insert_unique_pos(const Key& k)
 	{
 		link_type y = header;
 		link_type x = root();
@@ -441,63 +1335,155 @@ public:
 		while(x)
 		{
 			y = x;
-			comp = key_compare(KeyOfValue()(v), key(x));
+			comp = key_compare(k, key(x));
 			x = comp ? left(x) : right(x);
 		}
-		// after the loop, x = null where v to be inserted and ...
-		//              ...y is the leap, parent of x (or say v)
+		// after the loop, x = null where k to be inserted and ...
+		//              ...y is the leap, parent of x (or say k)
 		
 		iterator j = iterator(y);
 
 		if (comp)
+		{
 			if(j == begin())
-				return pair<iterator, bool>(__insert(x, y, v), true);
+				return pair<link_type, bool>(y, true);
 			else
 				--j;
-		if(key_compare(key(j.node), KeyOfValue()(v)))
-			return pair<iterator, bool>(__insert(x, y, v), true);
-
-		return pair<iterator, bool>(j, false);
+		}
+		if(key_compare(key(j.node), k))
+			return pair<link_type, bool>(y, true);
 
+		return pair<link_type, bool>((link_type)j.node, false);
 	}
 
-	// insert and allow duplicate node
-	// used for multimap / multiset
-	iterator insert_equal(const value_type& v)
+	// Parent under which k is to be inserted, after its equals
+	link_type __insert_equal_pos(const Key& k)
 	{
 		link_type y = header;
 		link_type x = root();
 		while(x)
 		{
 			y = x;
-			x = key_compare(KeyOfValue()(v), key(x)) ? left(x) : right(x);
+			x = key_compare(k, key(x)) ? left(x) : right(x);
 		}
-		// after the loop, x = null where v to be inserted and ...
-		//              ...y is the leap, parent of x (or say v)
-		return __insert(x, y, v);
+		return y;
 	}
 
-	// find
-	iterator find(const Key& k)
+	template <class K>
+	iterator __find(const K& k) const
 	{
-		link_type y = header;
-		link_type x = root();
+		iterator j = __lower_bound(root(), header, k);
+		return (j == end() || key_compare(k, key(j.node))) ? end() : j;
+	}
+};
 
-		while(x)
+// Copy the subtree x under p, colors (and metas) included: no
+// comparison, no rebalancing. Iterative preorder walk of x, going back
+// up by the parent links of both trees, so the stack stays flat
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc, class Augment>
+typename rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>::link_type
+rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>::__copy(link_type x,
+														link_type p)
+{
+	link_type top = clone_node(x);
+	top->set_parent(p);
+	link_type s = x;	// source node
+	link_type d = top;	// its copy
+	try {
+		for(;;)
 		{
-			//if x > k
-			if(!key_compare(key(x), k))
+			link_type n;
+			if(s->left && !d->left)
 			{
-				y = x;
-				x = left(x);
+				s = left(s);
+				n = clone_node(s);
+				d->left = n;
+			}
+			else if(s->right && !d->right)
+			{
+				s = right(s);
+				n = clone_node(s);
+				d->right = n;
 			}
 			else
-				x = right;
+			{
+				// both subtrees done
+				if(s == x)
+					break;
+				s = parent(s);
+				d = parent(d);
+				continue;
+			}
+			n->set_parent(d);
+			d = n;
 		}
-		iterator j = iterator(y);
-		return (j == end() || key_compare(k, key(j.node))) ? end() : j;
 	}
-};
+	catch(...){
+		__erase(top);
+		throw;
+	}
+	return top;
+}
+
+// Free the subtree x without rebalancing. Iterative: while x has a
+// left child, rotate it up (the tree is being torn down, the order of
+// the nodes is all that is kept); else free x and go on to its right.
+// O(n), and the nodes go back to the allocator's free lists by put_node
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc, class Augment>
+void rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>::__erase(link_type x)
+{
+	while(x)
+	{
+		link_type y = left(x);
+		if(y)
+		{
+			x->left = y->right;
+			y->right = x;
+		}
+		else
+		{
+			y = right(x);
+			destroy_node(x);
+		}
+		x = y;
+	}
+}
+
+// The nodes of the old tree are freed before the copy is built, so
+// the copy reuses them from the allocator's free lists
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc, class Augment>
+rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>&
+rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>::operator=(
+	const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& x)
+{
+	if(this != &x)
+	{
+		clear();
+		key_compare = x.key_compare;
+		copy_from(x);
+	}
+	return *this;
+}
+
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc, class Augment>
+inline bool operator==(const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& x,
+					   const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& y)
+{
+	return x.size() == y.size() && fyj::equal(x.begin(), x.end(), y.begin());
+}
+
+template <class Key, class Value, class KeyOfValue, class Compare,
+		  class Alloc, class Augment>
+inline bool operator<(const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& x,
+					  const rb_tree<Key, Value, KeyOfValue, Compare, Alloc, Augment>& y)
+{
+	return fyj::lexicographical_compare(x.begin(), x.end(),
+										y.begin(), y.end());
+}
 
 }// end of namespace
 
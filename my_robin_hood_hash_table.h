@@ -0,0 +1,685 @@
+/* Robin Hood hash table, the open addressing layout of unordered_map / set
+ *
+ * Linear probing in one flat array of values, plus one byte per slot
+ * holding the probe distance of its element (+1, 0 = free):
+ *     # insert: an element that is further from its home slot than
+ *       the one it meets takes that slot, so no element is ever much
+ *       unluckier than the others ("take from the rich")
+ *     # the run is kept sorted by home slot, so a lookup stops as soon
+ *       as it meets an element closer to home than the probe is:
+ *       misses stop early instead of running to the next free slot
+ *     # erase shifts the rest of the run back by one (no tombstones)
+ *     # a probe distance never exceeds __rh_max_dist, the table grows
+ *       instead, so the worst lookup is bounded
+ * Growing cannot split keys of equal hash: they share a home slot at
+ * any size. So an insert that would make more than __rh_max_dist keys
+ * of one hash (a poor or colliding HashFun) throws length_error and
+ * leaves the table as it was; such keys need the chaining layout.
+ *
+ * Same HashFun / ExtractKey / EqualKey policies as "my_hash_table.h".
+ * Elements are moved by copy construction, never assigned, so the
+ * key of pair<const Key, T> stays const.
+ * Inserts and erases move other elements: both invalidate iterators.
+ *
+ * There are no nodes: extract() copies the element into a node
+ * (the same node_type as the chaining table) and inserting a node
+ * copies it back.
+ */
+
+#ifndef _MY_ROBIN_HOOD_HASH_TABLE_
+#define _MY_ROBIN_HOOD_HASH_TABLE_
+
+#include "my_alloc.h"
+#include <stddef.h>
+#include <stdexcept>
+#include "my_algo.h"
+#include "my_construct.h"
+#include "my_iterator.h"
+#include "my_functors.h"
+#include "my_pair.h"
+#include "my_node_handle.h"
+#include "my_hash_table.h"
+#include "my_int_hash_table.h" // for __int_hash_mix, __int_hash_range
+
+namespace fyj
+{
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class EqualKey, class Alloc = alloc>
+class robin_hood_hashtable;
+
+template <class Value, class Ref, class Ptr, class Table>
+struct __robin_hood_iterator
+{
+	typedef __robin_hood_iterator<Value, Value&, Value*, Table> iterator;
+	typedef __robin_hood_iterator<Value, const Value&, const Value*,
+								  Table> const_iterator;
+	typedef __robin_hood_iterator<Value, Ref, Ptr, Table> self;
+
+	typedef forward_iterator_tag iterator_category;
+	typedef Value value_type;
+	typedef ptrdiff_t difference_type;
+	typedef size_t size_type;
+	typedef Ref reference;
+	typedef Ptr pointer;
+
+	size_type pos;
+	const Table* ht;
+
+	__robin_hood_iterator(){}
+	__robin_hood_iterator(size_type p, const Table* tab)
+		: pos(p), ht(tab) {}
+	__robin_hood_iterator(const iterator& it)
+		: pos(it.pos), ht(it.ht) {}
+
+	reference operator*() const {return ht->slots[pos];}
+	pointer operator->() const {return &(operator*());}
+
+	self& operator++()
+	{
+		pos = ht->next_used(pos + 1);
+		return *this;
+	}
+
+	self operator++(int)
+	{
+		self temp = *this;
+		++*this;
+		return temp;
+	}
+
+	bool operator==(const self& it) const {return it.pos == pos;}
+	bool operator!=(const self& it) const {return it.pos != pos;}
+};
+
+// Longest probe distance (+1) a slot may record
+static const unsigned char __rh_max_dist = 255;
+
+// @Value: used for map; for set, value = key
+// @Key: used for map and set
+// @HashFun: input_value -> hash_value defined in "my_functors.h"
+// @ExtractKey: extract the key of a given value
+// @EqualKey: judge if two keys are equal
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class EqualKey, class Alloc>
+class robin_hood_hashtable
+{
+public:
+	typedef HashFun hasher;
+	typedef EqualKey key_equal;
+	typedef Key key_type;
+	typedef Value value_type;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	typedef value_type* pointer;
+	typedef const value_type* const_pointer;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+
+	typedef __robin_hood_iterator<Value, Value&, Value*,
+								  robin_hood_hashtable> iterator;
+	typedef __robin_hood_iterator<Value, const Value&, const Value*,
+								  robin_hood_hashtable> const_iterator;
+	typedef __node_handle<__hashtable_node<Value>, Value,
+						  &__hashtable_node<Value>::val, Alloc> node_type;
+	friend struct __robin_hood_iterator<Value, Value&, Value*,
+										robin_hood_hashtable>;
+	friend struct __robin_hood_iterator<Value, const Value&, const Value*,
+										robin_hood_hashtable>;
+
+private:
+	typedef simple_alloc<value_type, Alloc> slot_allocator;
+	typedef simple_alloc<unsigned char, Alloc> dist_allocator;
+	typedef simple_alloc<__hashtable_node<Value>, Alloc> node_allocator;
+
+	hasher hash;
+	key_equal equals;
+	ExtractKey get_key;
+
+	// slots[i] is constructed iff dist[i] != 0;
+	// dist[capacity] is a non-zero guard that stops iteration
+	value_type* slots;
+	unsigned char* dist;
+	size_type capacity;
+	size_type num_elements;
+
+	float max_load;
+	size_type grow_threshold;
+
+	enum {min_capacity = 8};
+
+	template <class K>
+	size_type home(const K& key) const
+	{return __int_hash_range(__int_hash_mix(hash(key)), capacity);}
+
+	size_type next_slot(size_type i) const
+	{return ++i == capacity ? 0 : i;}
+	size_type prev_slot(size_type i) const
+	{return (i == 0 ? capacity : i) - 1;}
+
+	// First used position at or after pos, capacity is the end
+	size_type next_used(size_type pos) const
+	{
+		while(dist[pos] == 0)
+			++pos;
+		return pos;
+	}
+
+	void update_threshold()
+	{
+		grow_threshold = size_type(capacity * max_load);
+		if(grow_threshold >= capacity)
+			grow_threshold = capacity - 1;
+	}
+
+	size_type capacity_for(size_type n) const
+	{
+		size_type c = size_type(n / max_load) + 1;
+		return c < min_capacity ? size_type(min_capacity) : c;
+	}
+
+	void allocate_table(size_type n)
+	{
+		value_type* s = slot_allocator::allocate(n);
+		try {
+			dist = dist_allocator::allocate(n + 1);
+		}
+		catch(...){
+			slot_allocator::deallocate(s, n);
+			throw;
+		}
+		slots = s;
+		fill_n(dist, n, (unsigned char)0);
+		dist[n] = 1;
+		capacity = n;
+		update_threshold();
+	}
+
+	void free_table(value_type* s, unsigned char* d, size_type n)
+	{
+		for(size_type i = 0; i < n; ++i)
+			if(d[i])
+				destroy(s + i);
+		slot_allocator::deallocate(s, n);
+		dist_allocator::deallocate(d, n + 1);
+	}
+
+	// Slot of key, or capacity if absent.
+	// Stops when the probe is further from home than the slot's element
+	template <class K>
+	size_type find_pos(const K& key) const
+	{
+		size_type i = home(key);
+		for(unsigned d = 1; d <= dist[i]; ++d, i = next_slot(i))
+		{
+			if(dist[i] == d && equals(get_key(slots[i]), key))
+				return i;
+		}
+		return capacity;
+	}
+
+	// Place obj, known absent, at distance d from home in slot i:
+	// shift the run [i, first free slot) forward by one.
+	// Returns false (and changes nothing) if a distance would overflow
+	bool place(size_type i, unsigned d, const value_type& obj)
+	{
+		if(d > __rh_max_dist)
+			return false;
+		size_type e = i;
+		while(dist[e])
+		{
+			if(dist[e] == __rh_max_dist)
+				return false;
+			e = next_slot(e);
+		}
+		for(; e != i; e = prev_slot(e))
+		{
+			size_type p = prev_slot(e);
+			construct(slots + e, slots[p]);
+			dist[e] = dist[p] + 1;
+			destroy(slots + p);
+			dist[p] = 0;
+		}
+		construct(slots + i, obj);
+		dist[i] = d;
+		++num_elements;
+		return true;
+	}
+
+	// Insertion point of key: first slot whose element is closer to
+	// home than the probe (or free). found is set if key is present
+	size_type probe(const key_type& key, unsigned& d, bool& found) const
+	{
+		size_type i = home(key);
+		found = false;
+		for(d = 1; d <= dist[i]; ++d, i = next_slot(i))
+		{
+			if(dist[i] == d && equals(get_key(slots[i]), key))
+			{
+				found = true;
+				break;
+			}
+		}
+		return i;
+	}
+
+	// Copy every element to a table of n slots, keys are known unique.
+	// If a run is still too long (false) or a copy throws, the new
+	// table is freed and the old one kept as it was
+	bool try_rebuild(size_type n)
+	{
+		value_type* old_slots = slots;
+		unsigned char* old_dist = dist;
+		size_type old_n = capacity;
+		size_type old_count = num_elements;
+		allocate_table(n);
+		num_elements = 0;
+		bool placed = true;
+		try {
+			for(size_type i = 0; placed && i < old_n; ++i)
+			{
+				if(!old_dist[i])
+					continue;
+				unsigned d;
+				bool found;
+				size_type pos = probe(get_key(old_slots[i]), d, found);
+				placed = place(pos, d, old_slots[i]);
+			}
+		}
+		catch(...){
+			restore_table(old_slots, old_dist, old_n, old_count);
+			throw;
+		}
+		if(!placed)
+		{
+			restore_table(old_slots, old_dist, old_n, old_count);
+			return false;
+		}
+		free_table(old_slots, old_dist, old_n);
+		return true;
+	}
+
+	// Drop the table being built, back to the old one
+	void restore_table(value_type* s, unsigned char* d, size_type n,
+					   size_type count)
+	{
+		free_table(slots, dist, capacity);
+		slots = s;
+		dist = d;
+		capacity = n;
+		num_elements = count;
+		update_threshold();
+	}
+
+	// n slots, twice as many while a run is still too long
+	void rebuild(size_type n)
+	{
+		while(!try_rebuild(n))
+			n *= 2;
+	}
+
+	// Keys with the hash of key: all at their distance in its run
+	size_type count_hash(const key_type& key) const
+	{
+		size_t h = hash(key);
+		size_type n = 0;
+		size_type i = home(key);
+		for(unsigned d = 1; d <= dist[i]; ++d, i = next_slot(i))
+			if(dist[i] == d && hash(get_key(slots[i])) == h)
+				++n;
+		return n;
+	}
+
+	// Free slot i and shift the rest of its run back by one
+	void erase_pos(size_type i)
+	{
+		destroy(slots + i);
+		for(size_type j = next_slot(i); dist[j] > 1; j = next_slot(j))
+		{
+			construct(slots + i, slots[j]);
+			destroy(slots + j);
+			dist[i] = dist[j] - 1;
+			i = j;
+		}
+		dist[i] = 0;
+		--num_elements;
+	}
+
+	pair<iterator, bool> insert_unique_grow(const value_type& obj,
+											bool may_grow)
+	{
+		if(may_grow && num_elements >= grow_threshold)
+			rebuild(capacity * 2);
+		for(;;)
+		{
+			unsigned d;
+			bool found;
+			size_type i = probe(get_key(obj), d, found);
+			if(found)
+				return pair<iterator, bool>(iterator(i, this), false);
+			// noresize still grows once the table is full or a
+			// probe distance would overflow
+			if(num_elements + 1 < capacity && place(i, d, obj))
+				return pair<iterator, bool>(iterator(i, this), true);
+			// No size splits keys of equal hash, see the header
+			if(d > __rh_max_dist &&
+			   count_hash(get_key(obj)) >= __rh_max_dist)
+				throw std::length_error(
+					"robin_hood_hashtable: too many keys of one hash");
+			rebuild(capacity * 2);
+		}
+	}
+
+	void copy_from(const robin_hood_hashtable& ht)
+	{
+		allocate_table(ht.capacity);
+		num_elements = 0;
+		try {
+			for(size_type i = 0; i < capacity; ++i)
+			{
+				if(ht.dist[i])
+				{
+					construct(slots + i, ht.slots[i]);
+					dist[i] = ht.dist[i];
+					++num_elements;
+				}
+			}
+		}
+		catch(...){
+			free_table(slots, dist, capacity);
+			throw;
+		}
+	}
+
+public:
+	robin_hood_hashtable(size_type n, const HashFun& hf,
+						 const EqualKey& eql)
+		: hash(hf), equals(eql), get_key(ExtractKey()),
+		  num_elements(0), max_load(0.8f)
+	{
+		allocate_table(capacity_for(n));
+	}
+
+	robin_hood_hashtable(const robin_hood_hashtable& ht)
+		: hash(ht.hash), equals(ht.equals), get_key(ht.get_key),
+		  max_load(ht.max_load)
+	{
+		copy_from(ht);
+	}
+
+	robin_hood_hashtable& operator=(const robin_hood_hashtable& ht)
+	{
+		if(this != &ht)
+		{
+			robin_hood_hashtable temp(ht);
+			swap(temp);
+		}
+		return *this;
+	}
+
+	~robin_hood_hashtable() {free_table(slots, dist, capacity);}
+
+	void swap(robin_hood_hashtable& ht)
+	{
+		fyj::swap(hash, ht.hash);
+		fyj::swap(equals, ht.equals);
+		fyj::swap(slots, ht.slots);
+		fyj::swap(dist, ht.dist);
+		fyj::swap(capacity, ht.capacity);
+		fyj::swap(num_elements, ht.num_elements);
+		fyj::swap(max_load, ht.max_load);
+		fyj::swap(grow_threshold, ht.grow_threshold);
+	}
+
+	hasher hash_fun() const {return hash;}
+	key_equal key_eq() const {return equals;}
+
+	size_type bucket_count() const {return capacity;}
+	size_type max_bucket_count() const {return max_size();}
+	size_type size() const {return num_elements;}
+	size_type max_size() const {return size_type(-1) / sizeof(value_type);}
+	bool empty() const {return num_elements == 0;}
+
+	float load_factor() const {return float(num_elements) / capacity;}
+	float max_load_factor() const {return max_load;}
+	void max_load_factor(float z)
+	{
+		if(z <= 0)
+			return;
+		max_load = z;
+		update_threshold();
+		if(num_elements > grow_threshold)
+			rebuild(capacity_for(num_elements));
+	}
+
+	// Longest probe distance in the table, lookups never go further
+	size_type max_probe_length() const
+	{
+		unsigned char m = 0;
+		for(size_type i = 0; i < capacity; ++i)
+			if(dist[i] > m)
+				m = dist[i];
+		return m;
+	}
+
+	iterator begin() {return iterator(next_used(0), this);}
+	iterator end() {return iterator(capacity, this);}
+	const_iterator begin() const
+	{return const_iterator(next_used(0), this);}
+	const_iterator end() const {return const_iterator(capacity, this);}
+
+public:
+	// Size the table for num_elements_hint elements (never shrinks)
+	void resize(size_type num_elements_hint)
+	{
+		if(num_elements_hint > grow_threshold)
+			rebuild(capacity_for(num_elements_hint));
+	}
+	void reserve(size_type n) {resize(n);}
+	void rehash(size_type n_slots)
+	{
+		if(n_slots > capacity)
+			rebuild(n_slots);
+	}
+
+	pair<iterator, bool> insert_unique(const value_type& obj)
+	{return insert_unique_grow(obj, true);}
+
+	pair<iterator, bool> insert_unique_noresize(const value_type& obj)
+	{return insert_unique_grow(obj, false);}
+
+	template <class InputIterator>
+	void insert_unique(InputIterator first, InputIterator last)
+	{
+		for(; first != last; ++first)
+			insert_unique(*first);
+	}
+
+	reference find_or_insert(const value_type& obj)
+	{return *insert_unique(obj).first;}
+
+	iterator find(const key_type& key)
+	{return iterator(find_pos(key), this);}
+	const_iterator find(const key_type& key) const
+	{return const_iterator(find_pos(key), this);}
+
+	size_type count(const key_type& key) const
+	{return find_pos(key) != capacity ? 1 : 0;}
+
+	pair<iterator, iterator> equal_range(const key_type& key)
+	{
+		iterator first = find(key);
+		iterator last = first;
+		if(last.pos != capacity)
+			++last;
+		return pair<iterator, iterator>(first, last);
+	}
+	pair<const_iterator, const_iterator>
+	equal_range(const key_type& key) const
+	{
+		const_iterator first = find(key);
+		const_iterator last = first;
+		if(last.pos != capacity)
+			++last;
+		return pair<const_iterator, const_iterator>(first, last);
+	}
+
+	// Transparent lookup, see hashtable::find
+	template <class K>
+	typename __if_transparent<K, iterator, HashFun, EqualKey>::type
+	find(const K& key) {return iterator(find_pos(key), this);}
+
+	template <class K>
+	typename __if_transparent<K, const_iterator, HashFun, EqualKey>::type
+	find(const K& key) const {return const_iterator(find_pos(key), this);}
+
+	template <class K>
+	typename __if_transparent<K, size_type, HashFun, EqualKey>::type
+	count(const K& key) const {return find_pos(key) != capacity ? 1 : 0;}
+
+	template <class K>
+	typename __if_transparent<K, pair<const_iterator, const_iterator>,
+							  HashFun, EqualKey>::type
+	equal_range(const K& key) const
+	{
+		const_iterator first(find_pos(key), this);
+		const_iterator last = first;
+		if(last.pos != capacity)
+			++last;
+		return pair<const_iterator, const_iterator>(first, last);
+	}
+
+	void erase(const_iterator it) {erase_pos(it.pos);}
+
+	// Slot order is iteration order and an erase only shifts the
+	// elements after it back, so the range is erased in place
+	void erase(const_iterator first, const_iterator last)
+	{
+		size_type i = first.pos;
+		for(size_type n = distance(first, last); n; --n)
+		{
+			i = next_used(i);
+			erase_pos(i);
+		}
+	}
+
+	size_type erase(const key_type& key)
+	{
+		size_type i = find_pos(key);
+		if(i == capacity)
+			return 0;
+		erase_pos(i);
+		return 1;
+	}
+
+	void clear()
+	{
+		for(size_type i = 0; i < capacity; ++i)
+		{
+			if(dist[i])
+			{
+				destroy(slots + i);
+				dist[i] = 0;
+			}
+		}
+		num_elements = 0;
+	}
+
+public:
+	// Node handles: the element is copied into a node and back
+	node_type extract(const_iterator it)
+	{
+		__hashtable_node<Value>* n = node_allocator::allocate();
+		try {
+			construct(&n->val, *it);
+		}
+		catch(...){
+			node_allocator::deallocate(n);
+			throw;
+		}
+		n->next = 0;
+		erase_pos(it.pos);
+		return node_type(n);
+	}
+
+	node_type extract(const key_type& key)
+	{
+		size_type i = find_pos(key);
+		if(i == capacity)
+			return node_type();
+		return extract(const_iterator(i, this));
+	}
+
+	pair<iterator, bool> insert_unique(node_type& nh)
+	{
+		if(nh.empty())
+			return pair<iterator, bool>(end(), false);
+		pair<iterator, bool> p = insert_unique(nh.value());
+		if(p.second)
+			nh.reset(0);
+		return p;
+	}
+
+	// Move in the elements of ht whose key is not here yet
+	void merge_unique(robin_hood_hashtable& ht)
+	{
+		if(&ht == this)
+			return;
+		for(size_type i = 0; i < ht.capacity; )
+		{
+			// An erase shifts the next element into slot i
+			if(ht.dist[i] && insert_unique(ht.slots[i]).second)
+				ht.erase_pos(i);
+			else
+				++i;
+		}
+	}
+};
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class EqualKey, class Alloc>
+bool operator==(const robin_hood_hashtable<Value, Key, HashFun,
+										   ExtractKey, EqualKey, Alloc>& a,
+				const robin_hood_hashtable<Value, Key, HashFun,
+										   ExtractKey, EqualKey, Alloc>& b)
+{
+	typedef typename robin_hood_hashtable<Value, Key, HashFun, ExtractKey,
+						EqualKey, Alloc>::const_iterator const_iterator;
+	if(a.size() != b.size())
+		return false;
+	ExtractKey get_key;
+	for(const_iterator it = a.begin(); it != a.end(); ++it)
+	{
+		const_iterator f = b.find(get_key(*it));
+		if(f == b.end() || !(*f == *it))
+			return false;
+	}
+	return true;
+}
+
+//========================= TABLE LAYOUT ==================================
+
+// Last template argument of unordered_map / unordered_set
+struct chaining_hash_tag {};
+struct robin_hood_hash_tag {};
+
+template <class Layout, class Value, class Key, class HashFun,
+		  class ExtractKey, class EqualKey, class Alloc>
+struct __select_hashtable
+{
+	typedef hashtable<Value, Key, HashFun,
+					  ExtractKey, EqualKey, Alloc> type;
+};
+
+template <class Value, class Key, class HashFun,
+		  class ExtractKey, class EqualKey, class Alloc>
+struct __select_hashtable<robin_hood_hash_tag, Value, Key, HashFun,
+						  ExtractKey, EqualKey, Alloc>
+{
+	typedef robin_hood_hashtable<Value, Key, HashFun,
+								 ExtractKey, EqualKey, Alloc> type;
+};
+
+} // end of namespace
+
+#endif
@@ -36,6 +36,7 @@ ForwardIterator __uninitialized_copy_aux(InputIterator first, InputIterator last
 	{
 		construct(&*curr, *first);   //define in "my_construct.h" 
 	}
+	return curr;
 }
 
 template <class InputIterator, class ForwardIterator, class T>
@@ -10,6 +10,7 @@
 #include "my_iterator.h"
 #include "my_functors.h"
 #include "my_hash_table.h"
+#include "my_robin_hood_hash_table.h"
 
 namespace fyj
 {
@@ -17,13 +18,16 @@ namespace fyj
 template <class Value, 
 		  class HashFun = hash<Value>,
 		  class EqualKey = equal_to<Value>,
-		  class Alloc = alloc>
+		  class Alloc = alloc,
+		  class Layout = chaining_hash_tag>
 class unordered_set 
 {
 
 private:
-	typedef hashtable<Value, Value, HashFun, identity<Value>,
-					  EqualKey, Alloc> ht;
+	// Layout: chaining_hash_tag (hashtable) or
+	// robin_hood_hash_tag (robin_hood_hashtable)
+	typedef typename __select_hashtable<Layout, Value, Value, HashFun,
+					  identity<Value>, EqualKey, Alloc>::type ht;
     ht rep;
 
 public:
@@ -40,6 +44,7 @@ public:
 	typedef typename ht::const_reference const_reference;
 	typedef typename ht::const_iterator iterator;
 	typedef typename ht::const_iterator const_iterator;
+	typedef typename ht::node_type node_type;
 
 	hasher hash_fun() const {return rep.hash_fun();}
 	key_equal key_eq() const {return rep.key_eq();}
@@ -110,19 +115,74 @@ public:
 		return pair<iterator, bool>(p.first, p.second);
 	}
 
+	// Node handles: move elements between tables without reallocation
+	node_type extract(const_iterator it) {return rep.extract(it);}
+	node_type extract(const key_type& key) {return rep.extract(key);}
+
+	pair<iterator, bool> insert(node_type& nh)
+	{
+		pair<typename ht::iterator, bool> p = rep.insert_unique(nh);
+		return pair<iterator, bool>(p.first, p.second);
+	}
+
+	void merge(unordered_set& s) {rep.merge_unique(s.rep);}
+
 	iterator find(const key_type& key) const 
 	{return rep.find(key); }
 
+	// Transparent find / count / equal_range, see hashtable::find
+	template <class K>
+	typename __if_transparent<K, iterator, HashFun, EqualKey>::type
+	find(const K& key) const {return rep.find(key);}
+
+	template <class K>
+	typename __if_transparent<K, size_type, HashFun, EqualKey>::type
+	count(const K& key) const {return rep.count(key);}
+
+	template <class K>
+	typename __if_transparent<K, pair<iterator, iterator>,
+							  HashFun, EqualKey>::type
+	equal_range(const K& key) const {return rep.equal_range(key);}
+
+	// One iterator per key of [first, last) to out, end() if missing;
+	// the lookups of a batch overlap, see hashtable::find_batch
+	// (chained table only)
+	template <class ForwardIterator, class OutputIterator>
+	OutputIterator find_batch(ForwardIterator first, ForwardIterator last,
+							  OutputIterator out)
+	{return rep.find_batch(first, last, out);}
+
 	size_type count(const key_type& key) const
 	{return rep.count(key);}
 
+	pair<iterator, iterator> equal_range(const key_type& key) const
+	{return rep.equal_range(key);}
+
+	size_type erase(const key_type& key) {return rep.erase(key);}
+	void erase(const_iterator it) {rep.erase(it);}
+	void erase(const_iterator first, const_iterator last)
+	{rep.erase(first, last);}
+	void clear() {rep.clear();}
+
 public:
 	void resize(size_type hint) {rep.resize(hint);}
+	void reserve(size_type n) {rep.reserve(n);}
+	void rehash(size_type n_buckets) {rep.rehash(n_buckets);}
 	size_type bucket_count() const 
 	{return rep.bucket_count();}
 	size_type max_bucket_count() const 
 	{return rep.max_bucket_count();}
 
+	float load_factor() const {return rep.load_factor();}
+	float max_load_factor() const {return rep.max_load_factor();}
+	void max_load_factor(float z) {rep.max_load_factor(z);}
+
+	// Spread the rehash over the following inserts, see hashtable
+	// (chained table only)
+	void set_incremental_rehash(bool on) {rep.set_incremental_rehash(on);}
+	bool incremental_rehash() const {return rep.incremental_rehash();}
+	bool rehash_in_progress() const {return rep.rehash_in_progress();}
+
 };		
 
 
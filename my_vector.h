@@ -33,10 +33,10 @@ protected:
 	{
 		if (finish != end_of_storage)
 		{
-			construct(finish, *(finish-1));
+			fyj::construct(finish, *(finish-1));
 			++finish;
 			T x_copy = x;
-			copy_backward(position, finish - 2, finish - 1); 
+			fyj::copy_backward(position, finish - 2, finish - 1); 
 			*position = x_copy;
 		}
 		else
@@ -49,17 +49,17 @@ protected:
 			iterator new_start = data_allocator::allocate(len);
 			iterator new_finish = new_start;
 			try {
-				new_finish = uninitialized_copy(start, position, new_start);
-				construct(new_finish, x);
+				new_finish = fyj::uninitialized_copy(start, position, new_start);
+				fyj::construct(new_finish, x);
 				++new_finish;
-				new_finish = uninitialized_copy(position, finish, new_finish);
+				new_finish = fyj::uninitialized_copy(position, finish, new_finish);
 			}
 			catch(...){
-				destroy(new_start, new_finish);
+				fyj::destroy(new_start, new_finish);
 				data_allocator::deallocate(new_start, len);
 				throw;
 			}
-			destroy(begin(), end());
+			fyj::destroy(begin(), end());
 			deallocate();
 
 			start = new_start;
@@ -79,18 +79,18 @@ protected:
 			iterator old_finish = finish;
 			if (elems_after > n)
 			{
-				uninitialized_copy(finish-n, finish, finish);
+				fyj::uninitialized_copy(finish-n, finish, finish);
 				finish += n;
-				copy_backward(position, old_finish-n, old_finish);
-				fill(position, position+n, x_copy);
+				fyj::copy_backward(position, old_finish-n, old_finish);
+				fyj::fill(position, position+n, x_copy);
 			}
 			else
 			{
-				uninitialized_fill_n(finish, n - elems_after, x_copy);
+				fyj::uninitialized_fill_n(finish, n - elems_after, x_copy);
 				finish += n - elems_after;
-				uninitialized_copy(position, old_finish, finish);
+				fyj::uninitialized_copy(position, old_finish, finish);
 				finish += elems_after;
-				fill(position, old_finish, x_copy);
+				fyj::fill(position, old_finish, x_copy);
 			}
 		}
 		else
@@ -100,18 +100,18 @@ protected:
 			iterator new_start = data_allocator::allocate(len);
 			iterator new_finish = new_start;
 			try {
-				new_finish = uninitialized_copy(start, position, new_start);
-				new_finish = uninitialized_fill_n(new_finish, n, x);
-				new_finish = uninitialized_copy(position, finish, new_finish);
+				new_finish = fyj::uninitialized_copy(start, position, new_start);
+				new_finish = fyj::uninitialized_fill_n(new_finish, n, x);
+				new_finish = fyj::uninitialized_copy(position, finish, new_finish);
 			}
 			//# ifdef __STL_USE_EXCEPTIONS
 			catch(...){
-				destroy(new_start, new_finish);
+				fyj::destroy(new_start, new_finish);
 				data_allocator::deallocate(new_start, len);
 				throw;
 			}
 			//# endif		
-			destroy(start, finish);
+			fyj::destroy(start, finish);
 			deallocate();
 			start = new_start;
 			finish = new_finish;
@@ -135,7 +135,7 @@ protected:
 	iterator allocate_and_fill(size_type n, const T& value)
 	{
 		iterator result = data_allocator::allocate(n);
-		uninitialized_fill_n(result, n, value);
+		fyj::uninitialized_fill_n(result, n, value);
 		return result;
 	}
 
@@ -163,16 +163,38 @@ public:
 	explicit vector(size_type n){
 		fill_initialize(n, T()); 
 	}
-	// ~MyVector(){
-	// 	destroy(start, finish);
-	// 	deallocate();
-	// }
+	// An empty x allocates nothing
+	vector(const vector& x):start(0),finish(0),end_of_storage(0){
+		if (x.size() == 0)
+			return;
+		start = data_allocator::allocate(x.size());
+		try {
+			finish = fyj::uninitialized_copy(x.begin(), x.end(), start);
+		}
+		catch(...){
+			data_allocator::deallocate(start, x.size());
+			throw;
+		}
+		end_of_storage = finish;
+	}
+	vector& operator=(const vector& x){
+		if (this != &x)
+		{
+			vector temp(x);
+			swap(temp);
+		}
+		return *this;
+	}
+	~vector(){
+		fyj::destroy(start, finish);
+		deallocate();
+	}
 	reference front() {return *begin();}
 	reference back() {return *(end() - 1);}
 	void push_back(const T& value){
 		if (finish != end_of_storage)
 		{
-			construct(finish, value);
+			fyj::construct(finish, value);
 			++finish;
 		}
 		else
@@ -180,13 +202,45 @@ public:
 	}
 	void pop_back(){
 		--finish;
-		destroy(finish);
+		fyj::destroy(finish);
+	}
+	// insert x before position, return where it is now
+	iterator insert(iterator position, const T& x){
+		size_type n = position - begin();
+		if (finish != end_of_storage && position == end())
+		{
+			fyj::construct(finish, x);
+			++finish;
+		}
+		else
+			insert_aux(position, x);
+		return begin() + n;
+	}
+	// make room for n elements, so that the next pushes do not reallocate
+	void reserve(size_type n){
+		if (capacity() < n)
+		{
+			const size_type old_size = size();
+			iterator new_start = data_allocator::allocate(n);
+			try {
+				fyj::uninitialized_copy(start, finish, new_start);
+			}
+			catch(...){
+				data_allocator::deallocate(new_start, n);
+				throw;
+			}
+			fyj::destroy(start, finish);
+			deallocate();
+			start = new_start;
+			finish = new_start + old_size;
+			end_of_storage = new_start + n;
+		}
 	}
 	iterator erase(iterator position){
 		if (position + 1 != end())
-			copy(position + 1, finish, position);
+			fyj::copy(position + 1, finish, position);
 		--finish;
-		destroy(finish);
+		fyj::destroy(finish);
 		return position;
 	}
 	void resize(size_type new_size, const T& x){
@@ -201,9 +255,15 @@ public:
 	void clear(){
 		erase(begin(), end());
 	}
+	// only exchange the three pointers, no element is copied
+	void swap(vector& x){
+		fyj::swap(start, x.start);
+		fyj::swap(finish, x.finish);
+		fyj::swap(end_of_storage, x.end_of_storage);
+	}
 	iterator erase(iterator first, iterator last){
-		iterator i = copy(last, finish, first); //copy is global function defined in "my_algo.h"
-		destroy(i, finish);
+		iterator i = fyj::copy(last, finish, first); //copy is global function defined in "my_algo.h"
+		fyj::destroy(i, finish);
 		finish = finish - (last - first);
 		return first;
 	}